@@ -0,0 +1,151 @@
+#include "ContentHash.h"
+#include <cstring>
+
+static const uint64_t PRIME1 = 11400714785074694791ULL;
+static const uint64_t PRIME2 = 14029467366897019727ULL;
+static const uint64_t PRIME3 = 1609587929392839161ULL;
+static const uint64_t PRIME4 = 9650029242287828579ULL;
+static const uint64_t PRIME5 = 2870177450012600261ULL;
+
+static inline uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Little-endian loads, whatever the host byte order
+static inline uint64_t read64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static inline uint64_t read32(const unsigned char* p) {
+    return static_cast<uint64_t>(p[0]) | (static_cast<uint64_t>(p[1]) << 8) |
+           (static_cast<uint64_t>(p[2]) << 16) | (static_cast<uint64_t>(p[3]) << 24);
+}
+
+static inline uint64_t mix_round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * PRIME2;
+    accumulator = rotate_left(accumulator, 31);
+    return accumulator * PRIME1;
+}
+
+static inline uint64_t merge_round(uint64_t accumulator, uint64_t lane) {
+    accumulator ^= mix_round(0, lane);
+    return accumulator * PRIME1 + PRIME4;
+}
+
+ContentHash::ContentHash(uint64_t seed) : total_length(0), seed(seed), pending_length(0) {
+    lanes[0] = seed + PRIME1 + PRIME2;
+    lanes[1] = seed + PRIME2;
+    lanes[2] = seed;
+    lanes[3] = seed - PRIME1;
+}
+
+void ContentHash::consume_stripe(const unsigned char* stripe) {
+    for (int i = 0; i < 4; ++i) {
+        lanes[i] = mix_round(lanes[i], read64(stripe + 8 * i));
+    }
+}
+
+void ContentHash::update(const void* data, size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    total_length += length;
+
+    // Top up a partial stripe left over from the previous call first
+    if (pending_length > 0) {
+        size_t fill = 32 - pending_length;
+        if (length < fill) {
+            std::memcpy(pending + pending_length, bytes, length);
+            pending_length += static_cast<int>(length);
+            return;
+        }
+        std::memcpy(pending + pending_length, bytes, fill);
+        consume_stripe(pending);
+        bytes += fill;
+        length -= fill;
+        pending_length = 0;
+    }
+
+    for (; length >= 32; bytes += 32, length -= 32) {
+        consume_stripe(bytes);
+    }
+    if (length > 0) {
+        std::memcpy(pending, bytes, length);
+        pending_length = static_cast<int>(length);
+    }
+}
+
+uint64_t ContentHash::digest() const {
+    uint64_t hash;
+    if (total_length >= 32) {
+        hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            hash = merge_round(hash, lanes[i]);
+        }
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += total_length;
+
+    // Fold in the bytes that did not make a whole stripe
+    const unsigned char* p = pending;
+    int remaining = pending_length;
+    for (; remaining >= 8; p += 8, remaining -= 8) {
+        hash ^= mix_round(0, read64(p));
+        hash = rotate_left(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (remaining >= 4) {
+        hash ^= read32(p) * PRIME1;
+        hash = rotate_left(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+        remaining -= 4;
+    }
+    for (; remaining > 0; ++p, --remaining) {
+        hash ^= *p * PRIME5;
+        hash = rotate_left(hash, 11) * PRIME1;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t ContentHash::of_rows(const void* first_row, int width, int height, size_t row_bytes, size_t stride_bytes) {
+    const unsigned char size[8] = {
+        static_cast<unsigned char>(width), static_cast<unsigned char>(width >> 8),
+        static_cast<unsigned char>(width >> 16), static_cast<unsigned char>(width >> 24),
+        static_cast<unsigned char>(height), static_cast<unsigned char>(height >> 8),
+        static_cast<unsigned char>(height >> 16), static_cast<unsigned char>(height >> 24)
+    };
+    ContentHash hash;
+    hash.update(size, sizeof(size));
+    const unsigned char* row = static_cast<const unsigned char*>(first_row);
+    if (stride_bytes == row_bytes) {
+        hash.update(row, row_bytes * height);
+    } else {
+        for (int i = 0; i < height; ++i, row += stride_bytes) {
+            hash.update(row, row_bytes);
+        }
+    }
+    return hash.digest();
+}
+
+uint64_t ContentHash::of(const ConstImageView& view) {
+    return of_rows(view.get_pixels(), view.get_width(), view.get_height(), view.get_width(), view.get_stride());
+}
+
+uint64_t ContentHash::of(const ConstImageView16& view) {
+    return of_rows(view.get_pixels(), view.get_width(), view.get_height(), sizeof(uint16_t) * view.get_width(),
+                   sizeof(uint16_t) * view.get_stride());
+}
+
+uint64_t ContentHash::of(const ConstImageViewF& view) {
+    return of_rows(view.get_pixels(), view.get_width(), view.get_height(), sizeof(float) * view.get_width(),
+                   sizeof(float) * view.get_stride());
+}
@@ -0,0 +1,42 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ImageView.h"
+
+// Streaming 64-bit hash of a byte sequence (the XXH64 algorithm). Feeding the same bytes
+// in any split gives the same digest, so rows at any stride hash like one tight buffer.
+class ContentHash {
+private:
+    uint64_t lanes[4];          // Accumulators of the 32-byte stripes seen so far
+    uint64_t total_length;
+    uint64_t seed;
+    unsigned char pending[32];  // Bytes not yet making a whole stripe
+    int pending_length;
+
+    // Mixes one 32-byte stripe into the lanes
+    void consume_stripe(const unsigned char* stripe);
+
+    // Hash of the size and then height rows of row_bytes bytes each, stride_bytes apart
+    static uint64_t of_rows(const void* first_row, int width, int height, size_t row_bytes, size_t stride_bytes);
+
+public:
+    explicit ContentHash(uint64_t seed = 0);
+
+    // Appends length bytes to the hashed sequence
+    void update(const void* data, size_t length);
+
+    // Hash of everything appended so far; more data may still be appended afterwards
+    uint64_t digest() const;
+
+    // Hash of a view's pixels, row by row; two views with the same size and pixels
+    // get the same hash whatever their strides. Pixels wider than a byte are hashed
+    // in the host's byte order.
+    static uint64_t of(const ConstImageView& view);
+    static uint64_t of(const ConstImageView16& view);
+    static uint64_t of(const ConstImageViewF& view);
+};
+
+#endif // CONTENT_HASH_H
@@ -0,0 +1,126 @@
+#include "ConvolutionKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <math.h>
+
+// Weights within this fraction of the largest weight of the rank-1 product count as equal
+static const double SEPARABLE_TOLERANCE = 1e-12;
+
+ConvolutionKernel::ConvolutionKernel(int width, int height, const std::vector<double>& weights)
+        : width(width), height(height), weights(weights), separable(false) {
+    if (width <= 0 || height <= 0 || width % 2 == 0 || height % 2 == 0) {
+        throw std::invalid_argument("Kernel width and height must be odd and positive.");
+    }
+    if (weights.size() != static_cast<size_t>(width) * height) {
+        throw std::invalid_argument("Kernel must have width * height weights.");
+    }
+    for (size_t i = 0; i < weights.size(); ++i) {
+        if (!std::isfinite(weights[i])) {
+            throw std::invalid_argument("Kernel weights must be finite.");
+        }
+    }
+    factorise();
+}
+
+// A rank-1 kernel is column_factor x row_factor for any of its nonzero rows and columns; the
+// ones through the largest weight keep the rounding of the factors smallest. The factorisation
+// is accepted if it reproduces every weight to within rounding.
+void ConvolutionKernel::factorise() {
+    size_t pivot = 0;
+    for (size_t k = 1; k < weights.size(); ++k) {
+        if (std::fabs(weights[k]) > std::fabs(weights[pivot])) {
+            pivot = k;
+        }
+    }
+    const double largest = std::fabs(weights[pivot]);
+    if (largest == 0.0) {
+        // All zeros: any factors will do
+        separable = true;
+        column_factor.assign(height, 0.0);
+        row_factor.assign(width, 0.0);
+        return;
+    }
+
+    const int p = static_cast<int>(pivot / width);
+    const int q = static_cast<int>(pivot % width);
+    std::vector<double> column(height);
+    std::vector<double> row(width);
+    for (int i = 0; i < height; ++i) {
+        column[i] = get_weight(i, q);
+    }
+    for (int j = 0; j < width; ++j) {
+        row[j] = get_weight(p, j) / weights[pivot];
+    }
+    for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+            if (std::fabs(get_weight(i, j) - column[i] * row[j]) > SEPARABLE_TOLERANCE * largest) {
+                return;
+            }
+        }
+    }
+    separable = true;
+    column_factor.swap(column);
+    row_factor.swap(row);
+}
+
+ConvolutionKernel ConvolutionKernel::sobel_x() {
+    const double weights[] = { -1, 0, 1,
+                               -2, 0, 2,
+                               -1, 0, 1 };
+    return ConvolutionKernel(3, 3, std::vector<double>(weights, weights + 9));
+}
+
+ConvolutionKernel ConvolutionKernel::sobel_y() {
+    const double weights[] = { -1, -2, -1,
+                                0,  0,  0,
+                                1,  2,  1 };
+    return ConvolutionKernel(3, 3, std::vector<double>(weights, weights + 9));
+}
+
+ConvolutionKernel ConvolutionKernel::laplacian() {
+    const double weights[] = { 0,  1, 0,
+                               1, -4, 1,
+                               0,  1, 0 };
+    return ConvolutionKernel(3, 3, std::vector<double>(weights, weights + 9));
+}
+
+ConvolutionKernel ConvolutionKernel::sharpen(double amount) {
+    const double weights[] = { 0,       -amount,          0,
+                               -amount, 1 + 4 * amount,   -amount,
+                               0,       -amount,          0 };
+    return ConvolutionKernel(3, 3, std::vector<double>(weights, weights + 9));
+}
+
+// The line is sampled every 1/8 pixel and each sample marks the pixel it falls in. The kernel
+// is cropped to the rows and columns the line reaches, so a horizontal blur is 1 x length.
+ConvolutionKernel ConvolutionKernel::motion_blur(int length, double angle) {
+    if (length <= 0 || length % 2 == 0) {
+        throw std::invalid_argument("Motion blur length must be odd and positive.");
+    }
+    const int radius = (length - 1) / 2;
+    const double dx = std::cos(angle * M_PI / 180.0);
+    const double dy = -std::sin(angle * M_PI / 180.0);     // Rows grow downwards
+
+    std::vector<std::pair<int, int> > cells;    // (row, column) offsets from the centre
+    int reach_x = 0;
+    int reach_y = 0;
+    for (int s = -8 * radius; s <= 8 * radius; ++s) {
+        const int x = static_cast<int>(std::lround(s / 8.0 * dx));
+        const int y = static_cast<int>(std::lround(s / 8.0 * dy));
+        cells.push_back(std::make_pair(y, x));
+        reach_x = std::max(reach_x, std::abs(x));
+        reach_y = std::max(reach_y, std::abs(y));
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    const int width = 2 * reach_x + 1;
+    const int height = 2 * reach_y + 1;
+    std::vector<double> weights(static_cast<size_t>(width) * height, 0.0);
+    for (size_t c = 0; c < cells.size(); ++c) {
+        weights[static_cast<size_t>(cells[c].first + reach_y) * width + (cells[c].second + reach_x)] = 1.0 / cells.size();
+    }
+    return ConvolutionKernel(width, height, weights);
+}
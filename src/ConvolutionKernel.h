@@ -0,0 +1,58 @@
+#ifndef CONVOLUTION_KERNEL_H
+#define CONVOLUTION_KERNEL_H
+
+#include <cstddef>
+#include <vector>
+
+// A user-defined 2D kernel for Filter::convolve: width x height weights (both odd), centred
+// on the pixel being filtered. The constructor checks whether the kernel is separable, i.e.
+// the outer product of a column and a row (rank 1), and keeps the two factors if it is, so
+// that Filter::convolve can run it as two 1D passes.
+class ConvolutionKernel {
+private:
+    int width;
+    int height;
+    std::vector<double> weights;        // Row-major, height rows of width weights
+    bool separable;
+    std::vector<double> column_factor;  // weights[i * width + j] == column_factor[i] * row_factor[j]
+    std::vector<double> row_factor;
+
+    // Rank-1 test: factors the kernel through its largest weight and checks every product
+    void factorise();
+
+public:
+    // Constructor: weights are row-major and must hold width * height finite values.
+    // Throws std::invalid_argument if width or height is not odd and positive, or the
+    // weights do not fit.
+    ConvolutionKernel(int width, int height, const std::vector<double>& weights);
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_radius_x() const { return (width - 1) / 2; }
+    int get_radius_y() const { return (height - 1) / 2; }
+
+    // Weight applied to the pixel row - get_radius_y() + i, col - get_radius_x() + j
+    double get_weight(int i, int j) const { return weights[static_cast<size_t>(i) * width + j]; }
+    const std::vector<double>& get_weights() const { return weights; }
+
+    // True if every weight equals column_factor[i] * row_factor[j] up to double rounding
+    bool is_separable() const { return separable; }
+
+    // The factors of a separable kernel (height and width entries); empty otherwise
+    const std::vector<double>& get_column_factor() const { return column_factor; }
+    const std::vector<double>& get_row_factor() const { return row_factor; }
+
+    // Common kernels. Sobel responses and the Laplacian are signed, so they are best applied
+    // to float images; on integer images negative results clamp to 0.
+    static ConvolutionKernel sobel_x();         // d/dx: [1 2 1]^T x [-1 0 1]
+    static ConvolutionKernel sobel_y();         // d/dy: [-1 0 1]^T x [1 2 1]
+    static ConvolutionKernel laplacian();       // 4-neighbour Laplacian
+    static ConvolutionKernel sharpen(double amount);    // identity + amount * (-Laplacian)
+
+    // Blur along a line of length pixels through the centre, at angle degrees counter-clockwise
+    // from the x axis (the y axis pointing up); every pixel the line crosses gets the same weight.
+    // length must be odd and positive.
+    static ConvolutionKernel motion_blur(int length, double angle);
+};
+
+#endif // CONVOLUTION_KERNEL_H
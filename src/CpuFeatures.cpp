@@ -0,0 +1,111 @@
+#include "CpuFeatures.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CLEARVISION_X86 1
+#endif
+
+#if defined(CLEARVISION_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+
+// MSVC has no __builtin_cpu_supports, so read the feature bits directly. The AVX levels also
+// need the OS to save the wider registers on context switches, which XCR0 reports.
+static CpuFeatures::Level detect_level() {
+    int regs[4];
+    __cpuid(regs, 0);
+    const int max_leaf = regs[0];
+
+    __cpuid(regs, 1);
+    const bool sse2 = (regs[3] & (1 << 26)) != 0;
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx = (regs[2] & (1 << 28)) != 0;
+    if (!sse2) {
+        return CpuFeatures::LEVEL_SCALAR;
+    }
+    if (!osxsave || !avx || max_leaf < 7) {
+        return CpuFeatures::LEVEL_SSE2;
+    }
+
+    const unsigned long long xcr0 = _xgetbv(0);
+    const bool ymm_state = (xcr0 & 0x6) == 0x6;      // SSE and AVX state
+    const bool zmm_state = (xcr0 & 0xE6) == 0xE6;    // plus opmask and both ZMM halves
+
+    __cpuidex(regs, 7, 0);
+    const bool avx2 = (regs[1] & (1 << 5)) != 0;
+    const bool avx512f = (regs[1] & (1 << 16)) != 0;
+    const bool avx512bw = (regs[1] & (1 << 30)) != 0;
+
+    if (avx512f && avx512bw && zmm_state) {
+        return CpuFeatures::LEVEL_AVX512;
+    }
+    if (avx2 && ymm_state) {
+        return CpuFeatures::LEVEL_AVX2;
+    }
+    return CpuFeatures::LEVEL_SSE2;
+}
+
+#elif defined(CLEARVISION_X86) && defined(__GNUC__)
+
+// GCC and Clang check both the CPUID bits and the OS register state for us.
+static CpuFeatures::Level detect_level() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return CpuFeatures::LEVEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return CpuFeatures::LEVEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return CpuFeatures::LEVEL_SSE2;
+    }
+    return CpuFeatures::LEVEL_SCALAR;
+}
+
+#else
+
+// Not x86: only the portable kernels exist.
+static CpuFeatures::Level detect_level() {
+    return CpuFeatures::LEVEL_SCALAR;
+}
+
+#endif
+
+CpuFeatures::Level CpuFeatures::get_supported_level() {
+    static const Level supported = detect_level();
+    return supported;
+}
+
+CpuFeatures::Level CpuFeatures::get_startup_level() {
+    Level level = get_supported_level();
+    const char* forced = std::getenv("CLEARVISION_SIMD");
+    Level requested;
+    if (forced != nullptr && parse_level(forced, requested) && requested < level) {
+        level = requested;
+    }
+    return level;
+}
+
+const char* CpuFeatures::get_level_name(Level level) {
+    switch (level) {
+        case LEVEL_SSE2:
+            return "sse2";
+        case LEVEL_AVX2:
+            return "avx2";
+        case LEVEL_AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
+
+bool CpuFeatures::parse_level(const char* name, Level& level) {
+    const Level levels[] = { LEVEL_SCALAR, LEVEL_SSE2, LEVEL_AVX2, LEVEL_AVX512 };
+    for (int i = 0; i < 4; ++i) {
+        if (std::strcmp(name, get_level_name(levels[i])) == 0) {
+            level = levels[i];
+            return true;
+        }
+    }
+    return false;
+}
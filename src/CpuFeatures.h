@@ -0,0 +1,30 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// Instruction set levels the pixel kernels are built for, from narrowest to widest.
+// Each level implies the ones below it.
+class CpuFeatures {
+public:
+    enum Level {
+        LEVEL_SCALAR,   // Portable C++ only
+        LEVEL_SSE2,     // 128-bit integer and double vectors
+        LEVEL_AVX2,     // 256-bit vectors
+        LEVEL_AVX512    // 512-bit vectors (AVX-512 F + BW)
+    };
+
+    // Widest level this CPU and operating system support. Detected once, on first call.
+    static Level get_supported_level();
+
+    // Level the kernels should start on: the supported level, or the one named by the
+    // CLEARVISION_SIMD environment variable (scalar, sse2, avx2 or avx512) if it is set.
+    // A forced level above the supported one is lowered to it.
+    static Level get_startup_level();
+
+    // "scalar", "sse2", "avx2" or "avx512"
+    static const char* get_level_name(Level level);
+
+    // Parses a level name; returns false and leaves level untouched for unknown names.
+    static bool parse_level(const char* name, Level& level);
+};
+
+#endif // CPU_FEATURES_H
@@ -1,55 +1,47 @@
 #include "Crypto.h"
 #include "GrayscaleImage.h"
+#include "PixelKernels.h"
 
 
 // Extract the least significant bits (LSBs) from SecretImage, calculating x, y based on message length
 std::vector<int> Crypto::extract_LSBits(SecretImage& secret_image, int message_length) {
-    std::vector<int> LSB_array;
-
     // 1. Reconstruct the SecretImage to a GrayscaleImage.
-    // 2. Calculate the image dimensions.
-    // 3. Determine the total bits required based on message length.
-    // 4. Ensure the image has enough pixels; if not, throw an error.
-    // 5. Calculate the starting pixel from the message_length knowing that  
-    //    the last LSB to extract is in the last pixel of the image.
-    // 6. Extract LSBs from the image pixels and return the result.
-
+    // 2. Extract the LSBs from a view over the whole reconstructed image.
     secret_image.set_upper_tri_arr_size();
     secret_image.set_lower_tri_arr_size();
 
-    // 1. Reconstruct the SecretImage to a GrayscaleImage.
     GrayscaleImage yeni = secret_image.reconstruct();
+    return extract_LSBits(yeni.view(), message_length);
+}
+
+// Extract the least significant bits (LSBs) from a view, calculating x, y based on message length
+std::vector<int> Crypto::extract_LSBits(const ConstImageView& image, int message_length) {
+    std::vector<int> LSB_array;
 
-    // 2. Calculate the image dimensions.
-    yeni.set_pixel_amount();
-    // 3. Determine the total bits required based on message length.
+    // 1. Calculate the image dimensions.
+    // 2. Determine the total bits required based on message length.
+    // 3. Ensure the image has enough pixels; if not, return an empty array.
+    // 4. Calculate the starting pixel from the message_length knowing that
+    //    the last LSB to extract is in the last pixel of the image.
+    // 5. Extract LSBs from the image pixels and return the result.
+    int pixel_amount = image.get_width() * image.get_height();
     int total_bits_required = message_length * 7;
 
-    // 4. Ensure the image has enough pixels; if not, throw an error.
-    try {
-        if (yeni.get_pixel_amount() < total_bits_required){
-            throw std::exception();
-        }
-    } catch (const std::exception& e) {
-        // std::cerr << "ERROR: Total bits required are greater than pixel amount of the image." << std::endl;
+    if (pixel_amount < total_bits_required){
+        return LSB_array;
     }
 
-    // 5. Calculate the starting pixel from the message_length knowing that
-    //    the last LSB to extract is in the last pixel of the image.
-    int starting_pixel = yeni.get_pixel_amount() - total_bits_required;
-    int start_i = starting_pixel / secret_image.get_width();
-    int start_j = starting_pixel % secret_image.get_width();
-
-    // 6. Extract LSBs from the image pixels and return the result.
-    for (int j = start_j; j < secret_image.get_width(); ++j) {
-        std::bitset<8> current_bitset(yeni.get_pixel(start_i, j));
-        LSB_array.push_back(current_bitset[0]);
-    }
-    for (int i = (start_i + 1); i < secret_image.get_height(); ++i) {
-        for (int j = 0; j < secret_image.get_width(); ++j) {
-            std::bitset<8> current_bitset((yeni.get_data()[start_i + 1][j]));
-            LSB_array.push_back(current_bitset[0]);
-        }
+    int starting_pixel = pixel_amount - total_bits_required;
+    int start_i = starting_pixel / image.get_width();
+    int start_j = starting_pixel % image.get_width();
+
+    LSB_array.resize(total_bits_required);
+    size_t lsb_index = 0;
+    for (int i = start_i; i < image.get_height(); ++i) {
+        const int first = (i == start_i ? start_j : 0);
+        const int count = image.get_width() - first;
+        PixelKernels::extract_lsb(image.get_row(i) + first, LSB_array.data() + lsb_index, count);
+        lsb_index += count;
     }
     return LSB_array;
 }
@@ -84,6 +76,7 @@ std::string Crypto::decrypt_message(const std::vector<int>& LSB_array) {
         for (int i = 0; i < (LSB_array.size()/7); ++i) {
             message += char_array[i];
         }
+        delete[] char_array;
 
     } catch (const std::exception& e) {
         // std::cerr << "ERROR: LSB_array length is not valid for a message." << std::endl;
@@ -111,57 +104,11 @@ std::vector<int> Crypto::encrypt_message(const std::string& message) {
 
 // Embed LSB array into GrayscaleImage starting from the last bit of the image
 SecretImage Crypto::embed_LSBits(GrayscaleImage& image, const std::vector<int>& LSB_array) {
-    // SecretImage secret_image(nullptr);
-
-    // 1. Ensure the image has enough pixels to store the LSB array, else throw an error.
-    // 2. Find the starting pixel based on the message length knowing that  
-    //    the last LSB to embed should end up in the last pixel of the image.
-    // 3. Iterate over the image pixels, embedding LSBs from the array.
-    // 4. Return a SecretImage object constructed from the given GrayscaleImage 
+    // 1. Embed the LSBs into a view over the whole image.
+    // 2. Return a SecretImage object constructed from the given GrayscaleImage
     //    with the embedded message.
     image.set_pixel_amount();
-    try {
-        if (image.get_pixel_amount() < LSB_array.size()){
-            throw std::exception();
-        }
-        int starting_pixel = image.get_pixel_amount() - static_cast<int>(LSB_array.size());
-        int start_i = starting_pixel / image.get_width();
-        int start_j = starting_pixel % image.get_width();
-        int lsb_index = 0;
-
-        for (int i = start_i; i < image.get_height(); ++i) {
-            if (i == start_i){
-                for (int j = start_j; j < image.get_width(); ++j) {
-                    std::bitset<8> pixel_bitset(image.get_pixel(i, j));
-                    pixel_bitset[0] = LSB_array[lsb_index];
-                    lsb_index += 1;
-                    if (static_cast<int>(pixel_bitset.to_ulong()) > 255){
-                        image.set_pixel(i, j, 255);
-                    } else if (static_cast<int>(pixel_bitset.to_ulong()) < 0){
-                        image.set_pixel(i, j, 0);
-                    } else {
-                        image.set_pixel(i, j, (static_cast<int>(pixel_bitset.to_ulong())));
-                    }
-                }
-            } else {
-                for (int j = 0; j < image.get_width(); ++j) {
-                    std::bitset<8> pixel_bitset(image.get_pixel(i, j));
-                    pixel_bitset[0] = LSB_array[lsb_index];
-                    lsb_index += 1;
-                    if ((static_cast<int>(pixel_bitset.to_ulong())) > 255){
-                        image.set_pixel(i, j, 255);
-                    } else if ((static_cast<int>(pixel_bitset.to_ulong())) < 0){
-                        image.set_pixel(i, j, 0);
-                    } else {
-                        image.set_pixel(i, j, (static_cast<int>(pixel_bitset.to_ulong())));
-                    }
-                }
-            }
-        }
-
-    } catch (const std::exception& e){
-        // std::cerr << "ERROR: LSB_array size greater than pixel amount of the image." << std::endl;
-    }
+    embed_LSBits(image.view(), LSB_array);
 
     SecretImage secret_image(image);
 
@@ -170,4 +117,29 @@ SecretImage Crypto::embed_LSBits(GrayscaleImage& image, const std::vector<int>&
     secret_image.set_lower_tri_arr_size();
 
     return secret_image;
-}
\ No newline at end of file
+}
+
+// Embed LSB array into a view starting from the last bit of the view
+void Crypto::embed_LSBits(const ImageView& image, const std::vector<int>& LSB_array) {
+    // 1. Ensure the image has enough pixels to store the LSB array, else leave it untouched.
+    // 2. Find the starting pixel based on the message length knowing that
+    //    the last LSB to embed should end up in the last pixel of the image.
+    // 3. Iterate over the image pixels, replacing bit 0 of each with the next LSB.
+    long pixel_amount = static_cast<long>(image.get_width()) * image.get_height();
+    if (pixel_amount < static_cast<long>(LSB_array.size())){
+        // std::cerr << "ERROR: LSB_array size greater than pixel amount of the image." << std::endl;
+        return;
+    }
+
+    int starting_pixel = static_cast<int>(pixel_amount - static_cast<long>(LSB_array.size()));
+    int start_i = starting_pixel / image.get_width();
+    int start_j = starting_pixel % image.get_width();
+    size_t lsb_index = 0;
+
+    for (int i = start_i; i < image.get_height(); ++i) {
+        const int first = (i == start_i ? start_j : 0);
+        const int count = image.get_width() - first;
+        PixelKernels::embed_lsb(image.get_row(i) + first, LSB_array.data() + lsb_index, count);
+        lsb_index += count;
+    }
+}
@@ -2,6 +2,7 @@
 #define CRYPTO_H
 
 #include "SecretImage.h"
+#include "ImageView.h"
 #include <string>
 #include <vector>
 #include <bitset>
@@ -14,14 +15,23 @@ public:
     // Function to extract LSBs from SecretImage
     static std::vector<int> extract_LSBits(SecretImage& secret_image, int message_length);
 
+    // Extracts the LSBs of the last message_length * 7 pixels of a view (row-major order).
+    // Returns an empty array if the view is too small for the message.
+    static std::vector<int> extract_LSBits(const ConstImageView& image, int message_length);
+
     // Function to decrypt message from LSB array
     static std::string decrypt_message(const std::vector<int>& LSB_array);
 
     // Function to convert a string message into LSB array (encryption)
     static std::vector<int> encrypt_message(const std::string& message);
 
-    // Function to embed LSB array into SecretImage
+    // Function to embed LSB array into SecretImage.
+    // The SecretImage is built once and moved (or elided) out, never deep-copied.
     static SecretImage embed_LSBits(GrayscaleImage& image, const std::vector<int>& LSB_array);
+
+    // Embeds the LSB array in place so that the last bit lands in the last pixel of the view.
+    // Leaves the view untouched if it has fewer pixels than LSB_array has bits.
+    static void embed_LSBits(const ImageView& image, const std::vector<int>& LSB_array);
 };
 
 #endif // CRYPTO_H
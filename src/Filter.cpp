@@ -1,118 +1,1304 @@
 #include "Filter.h"
+#include "FourierTransform.h"
+#include "GaussianKernel.h"
+#include "PixelKernels.h"
+#include "RecursiveGaussian.h"
+#include "ThreadPool.h"
 #include <algorithm>
 #include <cmath>
+#include <complex>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 #include <numeric>
 #include <math.h>
 
-// Mean Filter
-void Filter::apply_mean_filter(GrayscaleImage& image, int kernelSize) {
-    // 1. Copy the original image for reference.
-    // 2. For each pixel, calculate the mean value of its neighbors using a kernel.
-    // 3. Update each pixel with the computed mean.
+// Map an out-of-image index back into [0, n) according to the border mode
+int Filter::border_index(int index, int n, BorderMode border) {
+    if (index >= 0 && index < n) {
+        return index;
+    }
+    switch (border) {
+        case BORDER_REPLICATE:
+            return index < 0 ? 0 : n - 1;
+        case BORDER_REFLECT: {
+            // Mirroring with the edge repeated has period 2n: abcd|dcba|abcd...
+            int period = 2 * n;
+            int m = index % period;
+            if (m < 0) m += period;
+            return m < n ? m : period - 1 - m;
+        }
+        case BORDER_WRAP: {
+            int m = index % n;
+            return m < 0 ? m + n : m;
+        }
+        default:
+            return -1;
+    }
+}
 
-    GrayscaleImage reference(image);
+// Copy a source row into padded[0, radius + width + radius): the row itself in the middle and
+// radius border pixels on each side. Filtering the padded row needs no bounds checks at all.
+template <typename Pixel>
+static void pad_row(const Pixel* source, int width, int radius, Filter::BorderMode border, Pixel* padded) {
+    std::memcpy(padded + radius, source, sizeof(Pixel) * width);
+    for (int i = 0; i < radius; ++i) {
+        int left = Filter::border_index(i - radius, width, border);
+        int right = Filter::border_index(width + i, width, border);
+        padded[i] = left < 0 ? 0 : source[left];
+        padded[radius + width + i] = right < 0 ? 0 : source[right];
+    }
+}
 
-    int current_pixel_value;
-    int kernel_matrix_sum;
-    int kernel_matrix_size = kernelSize * kernelSize;
+// Running window sums: out[i] = in[i] + ... + in[i + taps - 1] for n outputs. Each step adds the
+// entering value and subtracts the leaving one, so the cost does not depend on taps.
+template <typename In, typename Sum>
+static void running_sum(const In* in, int n, int taps, Sum* out) {
+    Sum sum = 0;
+    for (int t = 0; t < taps; ++t) {
+        sum += in[t];
+    }
+    out[0] = sum;
+    for (int i = 1; i < n; ++i) {
+        sum += static_cast<Sum>(in[i + taps - 1]) - in[i - 1];
+        out[i] = sum;
+    }
+}
 
-    for (int row_index = 0; row_index < reference.get_height(); ++row_index) {    // THESE TWO FOR LOOPS ARE FOR DOING THE EFFECT
-        for (int col_index = 0; col_index < reference.get_width(); ++col_index) { // TO EVERY SINGLE PIXEL OF THE IMAGE
+// Horizontal box sums of one source row (window of 2 * radius + 1 pixels)
+template <typename Pixel, typename Sum>
+static void box_sum_row(const Pixel* source, int width, int radius, Filter::BorderMode border,
+                        Pixel* padded, Sum* out) {
+    pad_row(source, width, radius, border, padded);
+    running_sum(padded, width, 2 * radius + 1, out);
+}
 
-            kernel_matrix_sum = 0;
+// out[i] += sum over t of weights[t] * padded[i + t]: the vector kernel for 8-bit rows, the
+// same sums in the same order for the wider pixel types
+static void convolve_row(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    PixelKernels::convolve_row(padded, weights, taps, out, n);
+}
 
-            // KERNEL MATRIX SUM
-            for (int i = -((kernelSize - 1) / 2); i <= ((kernelSize - 1) / 2); ++i) {      // THESE TWO FOR LOOPS ARE FOR REACHING
-                for (int j = -((kernelSize - 1) / 2); j <= ((kernelSize - 1) / 2); ++j) {  // EVERY PIXEL OF THE KERNEL MATRIX
+template <typename Pixel>
+static void convolve_row(const Pixel* padded, const double* weights, int taps, double* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        double sum = out[i];
+        for (int t = 0; t < taps; ++t) {
+            sum += weights[t] * padded[i + t];
+        }
+        out[i] = sum;
+    }
+}
 
-                    if ((row_index + i) < 0
-                        || (row_index + i) >= reference.get_height()
-                        || (col_index + j) < 0
-                        || (col_index + j) >= reference.get_width()){
+// out[i] = in[i] rounded down and clamped into the pixel range (kept as is for float pixels)
+static void store_row(const double* in, uint8_t* out, int n) {
+    PixelKernels::floor_row(in, out, n);
+}
 
-                        // pixel is out of the image bounds - black - 0
-                        current_pixel_value = 0;
-                        kernel_matrix_sum += current_pixel_value;
-                    } else {
-                        current_pixel_value = reference.get_data()[(row_index + i)][(col_index + j)];
-                        kernel_matrix_sum += current_pixel_value;
-                    }
+template <typename Pixel>
+static void store_row(const double* in, Pixel* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        out[i] = PixelTraits<Pixel>::from_double(in[i]);
+    }
+}
+
+// out[i] = original[i] + amount * (original[i] - blurred[i]) in the pixel range, with the
+// blurred value first stored to a pixel like store_row does
+static void unsharp_row(const uint8_t* original, const double* blurred, double amount, uint8_t* out, int n) {
+    PixelKernels::unsharp_row(original, blurred, amount, out, n);
+}
+
+template <typename Pixel>
+static void unsharp_row(const Pixel* original, const double* blurred, double amount, Pixel* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        const Pixel blurred_pixel = PixelTraits<Pixel>::from_double(blurred[i]);
+        out[i] = PixelTraits<Pixel>::from_double(original[i] + amount * (original[i] - blurred_pixel));
+    }
+}
+
+// Horizontal pass of one source row: the row extended by the border mode, convolved with weights
+template <typename Pixel>
+static void horizontal_row(const Pixel* source, int width, const std::vector<double>& weights,
+                           Filter::BorderMode border, Pixel* padded, double* out) {
+    const int taps = static_cast<int>(weights.size());
+    pad_row(source, width, (taps - 1) / 2, border, padded);
+    std::fill(out, out + width, 0.0);
+    convolve_row(padded, &weights[0], taps, out, width);
+}
+
+// The separable filters run in place and only keep the horizontal pass of the last few source
+// rows in a ring. The rows that vertical taps above and below the image map to are filtered up
+// front instead, before any source row is overwritten. border_rows[r] is empty unless row r is
+// one of them.
+template <typename T, typename HorizontalPass>
+static std::vector<std::vector<T> > filter_border_rows(int width, int height, int radius, Filter::BorderMode border,
+                                                       HorizontalPass horizontal_pass) {
+    std::vector<std::vector<T> > border_rows(height);
+    if (border == Filter::BORDER_ZERO) {
+        return border_rows;
+    }
+    for (int t = 1; t <= radius; ++t) {
+        const int mapped[2] = { Filter::border_index(-t, height, border),
+                                Filter::border_index(height - 1 + t, height, border) };
+        for (int m = 0; m < 2; ++m) {
+            if (mapped[m] >= 0 && border_rows[mapped[m]].empty()) {
+                border_rows[mapped[m]].resize(width);
+                horizontal_pass(mapped[m], &border_rows[mapped[m]][0]);
+            }
+        }
+    }
+    return border_rows;
+}
+
+// Horizontal pass of (possibly out-of-image) source row r: from the ring while r is inside the
+// image, from the border rows otherwise. nullptr stands for a row of zeros.
+template <typename T>
+static const T* tap_row(int r, int width, int height, int taps, Filter::BorderMode border,
+                        const std::vector<T>& ring, const std::vector<std::vector<T> >& border_rows) {
+    if (r >= 0 && r < height) {
+        return &ring[static_cast<size_t>(r % taps) * width];
+    }
+    int mapped = Filter::border_index(r, height, border);
+    return mapped < 0 ? nullptr : &border_rows[mapped][0];
+}
+
+// A horizontal band of output rows [first, last) filtered by one pool task.
+// The band owns its rows and overwrites them in place, but its kernel also reads up to radius
+// halo rows above and below, which neighbouring bands overwrite at the same time. Those halo
+// rows are copied when the band is set up, before any band starts running.
+template <typename Pixel>
+class RowBand {
+private:
+    BasicImageView<Pixel> image;
+    int first, last;
+    int top_first;                      // First image row held in top
+    std::vector<Pixel> top, bottom;     // Halo rows [top_first, first) and [last, last + bottom rows)
+
+public:
+    RowBand(const BasicImageView<Pixel>& image, int first, int last, int radius)
+            : image(image), first(first), last(last), top_first(std::max(0, first - radius)) {
+        const int width = image.get_width();
+        const int bottom_last = std::min(image.get_height(), last + radius);
+        top.resize(static_cast<size_t>(first - top_first) * width);
+        bottom.resize(static_cast<size_t>(bottom_last - last) * width);
+        for (int r = top_first; r < first; ++r) {
+            std::memcpy(&top[static_cast<size_t>(r - top_first) * width], image.get_row(r), sizeof(Pixel) * width);
+        }
+        for (int r = last; r < bottom_last; ++r) {
+            std::memcpy(&bottom[static_cast<size_t>(r - last) * width], image.get_row(r), sizeof(Pixel) * width);
+        }
+    }
+
+    int get_first() const { return first; }
+    int get_last() const { return last; }
+
+    // Original contents of image row r, for any r within radius of the band
+    const Pixel* get_source_row(int r) const {
+        const int width = image.get_width();
+        if (r < first) {
+            return &top[static_cast<size_t>(r - top_first) * width];
+        }
+        if (r >= last) {
+            return &bottom[static_cast<size_t>(r - last) * width];
+        }
+        return image.get_row(r);
+    }
+};
+
+// Splits the image rows into one band per pool thread. Every band re-filters 2 * radius halo
+// rows, so bands are never made thinner than max(32, 2 * radius) rows.
+template <typename Pixel>
+static std::vector<RowBand<Pixel> > make_bands(const BasicImageView<Pixel>& image, int radius) {
+    const int height = image.get_height();
+    const int min_rows = std::max(32, 2 * radius);
+    const int count = std::max(1, std::min(ThreadPool::shared().get_thread_count(), height / min_rows));
+
+    std::vector<RowBand<Pixel> > bands;
+    bands.reserve(count);
+    for (int b = 0; b < count; ++b) {
+        const int first = static_cast<int>(static_cast<long>(height) * b / count);
+        const int last = static_cast<int>(static_cast<long>(height) * (b + 1) / count);
+        bands.push_back(RowBand<Pixel>(image, first, last, radius));
+    }
+    return bands;
+}
+
+// Runs band_task on every band across the shared pool
+template <typename Pixel, typename BandTask>
+static void run_bands(const std::vector<RowBand<Pixel> >& bands, BandTask band_task) {
+    ThreadPool::shared().parallel_for(static_cast<int>(bands.size()), [&](int b) { band_task(bands[b]); });
+}
+
+// Set the number of threads the filters split their rows over
+void Filter::set_thread_count(int threads) {
+    ThreadPool::set_shared_thread_count(threads);
+}
+
+int Filter::get_thread_count() {
+    return ThreadPool::shared().get_thread_count();
+}
+
+// Horizontal pass of out-of-image source row r, for the filters that copy their rows into a
+// ring: the border row it maps to, or zeros
+template <typename Sum>
+static void copy_border_row(int r, int width, int height, Filter::BorderMode border,
+                            const std::vector<std::vector<Sum> >& border_rows, Sum* out) {
+    const int mapped = Filter::border_index(r, height, border);
+    if (mapped < 0) {
+        std::fill(out, out + width, Sum(0));
+    } else {
+        std::memcpy(out, &border_rows[mapped][0], sizeof(Sum) * width);
+    }
+}
+
+// One vertical box pass: the per-column sums of the last taps rows that entered, kept in a ring.
+// Integer sums are kept running, adding the entering row and subtracting the leaving one.
+// Floating-point sums depend on the order of the additions, so they are summed afresh for every
+// output row instead; that keeps the result the same however the rows are split into bands.
+template <typename Sum>
+class ColumnBoxSum {
+private:
+    int width;
+    int taps;
+    bool running;
+    int entered;                // Rows that entered so far; row e is in ring slot e % taps
+    std::vector<Sum> ring;
+    std::vector<Sum> sums;
+
+public:
+    ColumnBoxSum(int width, int taps)
+            : width(width), taps(taps), running(std::is_integral<Sum>::value), entered(0),
+              ring(static_cast<size_t>(taps) * width), sums(width, Sum(0)) {}
+
+    // Drops the row that leaves the window and returns its slot, for the entering row
+    Sum* begin_row() {
+        Sum* slot = &ring[static_cast<size_t>(entered % taps) * width];
+        if (running && entered >= taps) {
+            for (int col = 0; col < width; ++col) {
+                sums[col] -= slot[col];
+            }
+        }
+        return slot;
+    }
+
+    // Takes in the row written to begin_row()'s slot. Returns the sums over the last taps rows,
+    // or nullptr while fewer than taps rows have entered.
+    const Sum* end_row() {
+        const Sum* row = &ring[static_cast<size_t>(entered % taps) * width];
+        ++entered;
+        if (running) {
+            for (int col = 0; col < width; ++col) {
+                sums[col] += row[col];
+            }
+        }
+        if (entered < taps) {
+            return nullptr;
+        }
+        if (!running) {
+            std::fill(sums.begin(), sums.end(), Sum(0));
+            for (int e = entered - taps; e < entered; ++e) {
+                const Sum* window_row = &ring[static_cast<size_t>(e % taps) * width];
+                for (int col = 0; col < width; ++col) {
+                    sums[col] += window_row[col];
                 }
             }
-            // KERNEL MATRIX MEAN VALUE
-            image.get_data()[row_index][col_index] = (kernel_matrix_sum / kernel_matrix_size);
+        }
+        return &sums[0];
+    }
+};
+
+// Mean filter over the output rows of one band. Sum is an exact integer type for integer pixels.
+template <typename Pixel, typename Sum>
+static void mean_filter_band(const BasicImageView<Pixel>& image, const RowBand<Pixel>& band, int kernelSize,
+                             Filter::BorderMode border, const std::vector<std::vector<Sum> >& border_rows) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius = (kernelSize - 1) / 2;
+    const int kernel_matrix_size = kernelSize * kernelSize;
+
+    std::vector<Pixel> padded(width + 2 * radius);
+    ColumnBoxSum<Sum> vertical(width, 2 * radius + 1);
+
+    // Row e enters the vertical window; once it is full it holds rows e - 2 * radius .. e,
+    // i.e. it is complete for output row e - radius.
+    for (int entering = band.get_first() - radius; entering < band.get_last() + radius; ++entering) {
+        Sum* row = vertical.begin_row();
+        if (entering >= 0 && entering < height) {
+            box_sum_row(band.get_source_row(entering), width, radius, border, &padded[0], row);
+        } else {
+            copy_border_row(entering, width, height, border, border_rows, row);
+        }
+
+        // Source rows up to entering are consumed, so the output row can be overwritten.
+        const Sum* column_sums = vertical.end_row();
+        if (column_sums != nullptr) {
+            Pixel* out = image.get_row(entering - radius);
+            for (int col = 0; col < width; ++col) {
+                out[col] = static_cast<Pixel>(column_sums[col] / kernel_matrix_size);
+            }
         }
     }
 }
 
-// Gaussian Smoothing Filter
-void Filter::apply_gaussian_smoothing(GrayscaleImage& image, int kernelSize, double sigma) {
-    // 1. Create a Gaussian kernel based on the given sigma value.
-    // 2. Normalize the kernel to ensure it sums to 1.
-    // 3. For each pixel, compute the weighted sum using the kernel.
-    // 4. Update the pixel values with the smoothed results.
+// Mean Filter
+template <typename Pixel>
+void Filter::apply_mean_filter(const BasicImageView<Pixel>& image, int kernelSize, BorderMode border) {
+    // 1. For each source row, slide a window along it keeping a running sum (horizontal box sums).
+    // 2. Keep a running sum per column over the horizontal sums of the last kernelSize rows.
+    // 3. Update each pixel with that sum divided by kernelSize^2.
+    // Each step adds the entering pixel and subtracts the leaving one, so the cost per pixel does
+    // not depend on kernelSize. Out-of-image pixels follow the border mode and the divisor stays
+    // kernelSize * kernelSize at the borders too. Sums are exact integers, so the result is
+    // identical to summing every tap, and identical for any number of bands.
+
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius = (kernelSize - 1) / 2;
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    typedef typename PixelTraits<Pixel>::sum_type Sum;
+    std::vector<Pixel> padded(width + 2 * radius);
+    std::vector<std::vector<Sum> > border_rows = filter_border_rows<Sum>(width, height, radius, border,
+            [&](int row, Sum* out) { box_sum_row(image.get_row(row), width, radius, border, &padded[0], out); });
+
+    std::vector<RowBand<Pixel> > bands = make_bands(image, radius);
+    run_bands(bands, [&](const RowBand<Pixel>& band) {
+        mean_filter_band(image, band, kernelSize, border, border_rows);
+    });
+}
+
+// Gaussian Smoothing Filter over one band, evaluated as a full 2D convolution. Like the
+// separable version, each finished row is handed to write_row(band, row, blurred) as doubles.
+template <typename Pixel, typename RowWriter>
+static void gaussian_direct_band(const BasicImageView<Pixel>& image, const RowBand<Pixel>& band,
+                                 const GaussianKernel& kernel, Filter::BorderMode border,
+                                 const std::vector<std::vector<Pixel> >& border_rows, RowWriter write_row) {
+    // 1. Take the Gaussian kernel and its weight sum from the precomputed table.
+    // 2. For each pixel, compute the weighted sum using the kernel.
+    // 3. Normalize by the kernel sum and update the pixel values with the smoothed results.
+    // Pixels whose whole window lies inside the image are summed a whole row span at a time by
+    // the convolution kernel (kernel row by kernel row, in the same order as the loop below);
+    // only the border strips map their out-of-image taps through the border mode.
+    // The source rows of the window are copied into a ring of kernelSize rows before the rows
+    // they come from are overwritten.
 
-    GrayscaleImage reference(image);
+    const int height = image.get_height();
+    const int width = image.get_width();
+
+    const std::vector<double>& weights = kernel.get_weights_2d();
+    const double gaussian_weight_sum = kernel.get_weight_sum_2d();
+    const int radius = kernel.get_radius();
+    const int taps = 2 * radius + 1;
 
     double current_pixel_value;
     double gaussian_weighted_matrix_sum;
-    double gaussian_weight_sum;
-    double pixel_weight;
+    // source[r % taps] holds the original contents of image row r
+    std::vector<Pixel> source(static_cast<size_t>(taps) * width);
+    // interior_sums[col] is the sum for pixel col of an interior row, for col in [radius, width - radius)
+    const int interior_width = std::max(0, width - 2 * radius);
+    std::vector<double> interior_sums(width);
+    std::vector<double> blurred(width);
 
-    for (int row_index = 0; row_index < reference.get_height(); ++row_index) {    // THESE TWO FOR LOOPS ARE FOR DOING THE EFFECT
-        for (int col_index = 0; col_index < reference.get_width(); ++col_index) { // TO EVERY SINGLE PIXEL OF THE IMAGE
+    for (int r = std::max(0, band.get_first() - radius); r < std::min(height, band.get_first() + radius); ++r) {
+        std::memcpy(&source[static_cast<size_t>(r % taps) * width], band.get_source_row(r), sizeof(Pixel) * width);
+    }
+    for (int row_index = band.get_first(); row_index < band.get_last(); ++row_index) { // THESE TWO FOR LOOPS ARE FOR DOING THE EFFECT
+        // Row row_index + radius enters the window; the row it replaces in the ring has left it
+        const int entering = row_index + radius;
+        if (entering < height) {
+            std::memcpy(&source[static_cast<size_t>(entering % taps) * width], band.get_source_row(entering),
+                        sizeof(Pixel) * width);
+        }
+
+        const bool interior_row = row_index - radius >= 0 && row_index + radius < height;
+        if (interior_row && interior_width > 0) {
+            // GAUSSIAN MATRIX SUM, whole window inside the image
+            std::fill(interior_sums.begin(), interior_sums.end(), 0.0);
+            for (int i = 0; i < taps; ++i) {
+                convolve_row(tap_row(row_index - radius + i, width, height, taps, border, source, border_rows),
+                             &weights[i * taps], taps, &interior_sums[radius], interior_width);
+            }
+        }
+        for (int col_index = 0; col_index < width; ++col_index) {                      // TO EVERY SINGLE PIXEL OF THE IMAGE
 
-            gaussian_weight_sum = 0;
             gaussian_weighted_matrix_sum = 0;
 
-            // GAUSSIAN MATRIX SUM
-            for (int i = -((kernelSize - 1) / 2); i <= ((kernelSize - 1) / 2); ++i) {      // THESE TWO FOR LOOPS ARE FOR REACHING
-                for (int j = -((kernelSize - 1) / 2); j <= ((kernelSize - 1) / 2); ++j) {  // EVERY PIXEL OF THE KERNEL MATRIX
+            if (interior_row && col_index - radius >= 0 && col_index + radius < width) {
+                gaussian_weighted_matrix_sum = interior_sums[col_index];
+            } else {
+                // GAUSSIAN MATRIX SUM, window crossing the border
+                for (int i = -radius; i <= radius; ++i) {      // THESE TWO FOR LOOPS ARE FOR REACHING
+                    const Pixel* source_row = tap_row(row_index + i, width, height, taps, border, source, border_rows);
+                    for (int j = -radius; j <= radius; ++j) {  // EVERY PIXEL OF THE KERNEL MATRIX
+                        const int source_col = Filter::border_index(col_index + j, width, border);
+                        if (source_row == nullptr || source_col < 0) {
+                            // pixel is out of the image bounds - black - 0
+                            current_pixel_value = 0;
+                        } else {
+                            current_pixel_value = source_row[source_col];
+                        }
+                        gaussian_weighted_matrix_sum += weights[(i + radius) * taps + (j + radius)] * current_pixel_value;
+                    }
+                }
+            }
+            // GAUSSIAN MATRIX MEAN VALUE
+            blurred[col_index] = gaussian_weighted_matrix_sum / gaussian_weight_sum;
+        }
+        write_row(band, row_index, &blurred[0]);
+    }
+}
+
+// Gaussian Smoothing Filter, evaluated as a full 2D convolution. The image is filtered in place:
+// each band keeps the original rows of its current window in a ring, and the rows that taps
+// outside the image map to are copied up front. write_row is called as in gaussian_direct_band,
+// once for every image row.
+template <typename Pixel, typename RowWriter>
+static void gaussian_direct(const BasicImageView<Pixel>& image, const GaussianKernel& kernel,
+                            Filter::BorderMode border, RowWriter write_row) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius = kernel.get_radius();
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    std::vector<std::vector<Pixel> > border_rows = filter_border_rows<Pixel>(width, height, radius, border,
+            [&](int row, Pixel* out) { std::memcpy(out, image.get_row(row), sizeof(Pixel) * width); });
+
+    std::vector<RowBand<Pixel> > bands = make_bands(image, radius);
+    run_bands(bands, [&](const RowBand<Pixel>& band) {
+        gaussian_direct_band(image, band, kernel, border, border_rows, write_row);
+    });
+}
+
+// Separable convolution over the output rows of one band: row_weights horizontally, then
+// column_weights vertically (both of odd length). The filtered row is handed to
+// write_row(band, row, filtered) as doubles, which decides what to store in image row row.
+template <typename Pixel, typename RowWriter>
+static void separable_band(const BasicImageView<Pixel>& image, const RowBand<Pixel>& band,
+                           const std::vector<double>& row_weights, const std::vector<double>& column_weights,
+                           Filter::BorderMode border, const std::vector<std::vector<double> >& border_rows,
+                           RowWriter write_row) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius_x = (static_cast<int>(row_weights.size()) - 1) / 2;
+    const int radius = (static_cast<int>(column_weights.size()) - 1) / 2;
+    const int taps = 2 * radius + 1;
+
+    std::vector<Pixel> padded(width + 2 * radius_x);
+    // horizontal[r % taps] holds the horizontal pass of source row r
+    std::vector<double> horizontal(static_cast<size_t>(taps) * width);
+    std::vector<double> filtered(width);
+    std::vector<double> zeros(width, 0.0);
+    std::vector<const double*> window_rows(taps);
 
-                    pixel_weight = (exp(-((i*i + j*j)/(2*sigma*sigma)))) / (2*M_PI*sigma*sigma);
-                    gaussian_weight_sum += pixel_weight;
+    int next_source_row = std::max(0, band.get_first() - radius);
+    for (int row = band.get_first(); row < band.get_last(); ++row) {
+        // Every source row this output row depends on must be filtered before row is overwritten.
+        while (next_source_row < height && next_source_row <= row + radius) {
+            horizontal_row(band.get_source_row(next_source_row), width, row_weights, border, &padded[0],
+                           &horizontal[static_cast<size_t>(next_source_row % taps) * width]);
+            ++next_source_row;
+        }
+
+        // Vertical pass; rows are resolved once per output row, not per pixel. A zero row adds
+        // a zero to every sum, so it leaves them as skipping it would (-0.0 aside).
+        for (int t = -radius; t <= radius; ++t) {
+            const double* in = tap_row(row + t, width, height, taps, border, horizontal, border_rows);
+            window_rows[t + radius] = in == nullptr ? &zeros[0] : in;
+        }
+        PixelKernels::convolve_column(&window_rows[0], &column_weights[0], taps, &filtered[0], width);
+        write_row(band, row, &filtered[0]);
+    }
+}
+
+// Separable convolution, a horizontal and then a vertical 1D pass. Out-of-image taps follow
+// the border mode. The image is filtered in place: only the horizontal results of the last
+// column_weights.size() rows are kept, in a ring of double rows. write_row is called as in
+// separable_band, once for every image row.
+template <typename Pixel, typename RowWriter>
+static void separable_convolution(const BasicImageView<Pixel>& image, const std::vector<double>& row_weights,
+                                  const std::vector<double>& column_weights, Filter::BorderMode border,
+                                  RowWriter write_row) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius_x = (static_cast<int>(row_weights.size()) - 1) / 2;
+    const int radius = (static_cast<int>(column_weights.size()) - 1) / 2;
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    std::vector<Pixel> padded(width + 2 * radius_x);
+    std::vector<std::vector<double> > border_rows = filter_border_rows<double>(width, height, radius, border,
+            [&](int row, double* out) { horizontal_row(image.get_row(row), width, row_weights, border, &padded[0], out); });
+
+    std::vector<RowBand<Pixel> > bands = make_bands(image, radius);
+    run_bands(bands, [&](const RowBand<Pixel>& band) {
+        separable_band(image, band, row_weights, column_weights, border, border_rows, write_row);
+    });
+}
+
+// Gaussian Smoothing Filter, evaluated as a horizontal and then a vertical 1D pass.
+// exp(-(i^2 + j^2) / 2s^2) = exp(-i^2 / 2s^2) * exp(-j^2 / 2s^2), so the normalised 2D kernel
+// is the outer product of the normalised 1D kernel with itself. With BORDER_ZERO this matches
+// the direct version.
+template <typename Pixel, typename RowWriter>
+static void gaussian_separable(const BasicImageView<Pixel>& image, const GaussianKernel& kernel,
+                               Filter::BorderMode border, RowWriter write_row) {
+    separable_convolution(image, kernel.get_weights(), kernel.get_weights(), border, write_row);
+}
 
-                    if ((row_index + i) < 0
-                        || (row_index + i) >= reference.get_height()
-                        || (col_index + j) < 0
-                        || (col_index + j) >= reference.get_width()){
+// Direct 2D convolution over the output rows of one band. The band keeps its window of source
+// rows in a ring, already extended left and right by the border mode, so every kernel row is
+// one vector convolve_row call over the whole output row.
+template <typename Pixel, typename RowWriter>
+static void direct_band(const BasicImageView<Pixel>& image, const RowBand<Pixel>& band,
+                        const ConvolutionKernel& kernel, Filter::BorderMode border,
+                        const std::vector<std::vector<Pixel> >& border_rows, RowWriter write_row) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius_x = kernel.get_radius_x();
+    const int radius = kernel.get_radius_y();
+    const int taps = kernel.get_height();
+    const int padded_width = width + 2 * radius_x;
 
-                        // pixel is out of the image bounds - black - 0
-                        current_pixel_value = 0;
-                    } else {
-                        current_pixel_value = reference.get_data()[(row_index + i)][(col_index + j)];
+    // source[r % taps] holds source row r, padded
+    std::vector<Pixel> source(static_cast<size_t>(taps) * padded_width);
+    std::vector<double> filtered(width);
+
+    int next_source_row = std::max(0, band.get_first() - radius);
+    for (int row = band.get_first(); row < band.get_last(); ++row) {
+        while (next_source_row < height && next_source_row <= row + radius) {
+            pad_row(band.get_source_row(next_source_row), width, radius_x, border,
+                    &source[static_cast<size_t>(next_source_row % taps) * padded_width]);
+            ++next_source_row;
+        }
+
+        // Out-of-image rows under BORDER_ZERO add nothing and are skipped
+        std::fill(filtered.begin(), filtered.end(), 0.0);
+        for (int i = 0; i < taps; ++i) {
+            const Pixel* in = tap_row(row - radius + i, padded_width, height, taps, border, source, border_rows);
+            if (in != nullptr) {
+                convolve_row(in, &kernel.get_weights()[static_cast<size_t>(i) * kernel.get_width()],
+                             kernel.get_width(), &filtered[0], width);
+            }
+        }
+        write_row(band, row, &filtered[0]);
+    }
+}
+
+// Direct 2D convolution with every weight of the kernel, in place like the separable one. The
+// rows that taps outside the image map to are padded and copied up front.
+template <typename Pixel, typename RowWriter>
+static void direct_convolution(const BasicImageView<Pixel>& image, const ConvolutionKernel& kernel,
+                               Filter::BorderMode border, RowWriter write_row) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius_x = kernel.get_radius_x();
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    std::vector<std::vector<Pixel> > border_rows = filter_border_rows<Pixel>(width + 2 * radius_x, height,
+            kernel.get_radius_y(), border,
+            [&](int row, Pixel* out) { pad_row(image.get_row(row), width, radius_x, border, out); });
+
+    std::vector<RowBand<Pixel> > bands = make_bands(image, kernel.get_radius_y());
+    run_bands(bands, [&](const RowBand<Pixel>& band) {
+        direct_band(image, band, kernel, border, border_rows, write_row);
+    });
+}
+
+// Time an N x M tile takes per N * M * log2(N * M), in units of one vectorised kernel tap of
+// the direct paths (measured on 8-bit images)
+static const double FOURIER_POINT_COST = 9.0;
+
+// Largest overlap-add tile (FFT size) considered, in points, unless the kernel needs more.
+// Larger tiles fall out of the cache and get slower per point instead of faster.
+static const int FOURIER_MAX_TILE_POINTS = 1 << 18;
+
+// Integer results within this fraction of (L1 norm of the kernel) * (largest pixel value) of an
+// integer are taken as that integer before rounding down, so the FFT's rounding error does not
+// lose a gray level where the exact result is a whole number (flat regions, integer kernels)
+static const double FOURIER_SNAP_TOLERANCE = 1e-11;
+
+// Largest integer pixel value, which scales FOURIER_SNAP_TOLERANCE; float results are not snapped
+static double snap_range(const uint8_t*) { return PixelTraits<uint8_t>::max_value; }
+static double snap_range(const uint16_t*) { return PixelTraits<uint16_t>::max_value; }
+static double snap_range(const float*) { return 0.0; }
+
+// FFT sizes of the overlap-add tiles: each tile of rows x columns transform points convolves
+// (rows - kernel height + 1) x (columns - kernel width + 1) source pixels at once.
+struct FourierTiling {
+    int rows, columns;
+    double cost;            // Estimated cost per output pixel, comparable to a tap count
+};
+
+// The cheapest power-of-two tiling per output pixel, never larger than the image needs
+static FourierTiling choose_fourier_tiling(int kernel_width, int kernel_height, int width, int height) {
+    const int max_rows = FourierTransform::next_power_of_two(std::max(2, height + 2 * (kernel_height - 1)));
+    const int max_columns = FourierTransform::next_power_of_two(std::max(2, width + 2 * (kernel_width - 1)));
+    const int min_columns = FourierTransform::next_power_of_two(std::max(2, kernel_width));
+    FourierTiling best = { 0, 0, 0.0 };
+    for (int rows = FourierTransform::next_power_of_two(std::max(2, kernel_height)); ; rows *= 2) {
+        for (int columns = min_columns; ; columns *= 2) {
+            const double points = static_cast<double>(rows) * columns;
+            const double outputs = static_cast<double>(std::min(rows - kernel_height + 1, height)) *
+                                   std::min(columns - kernel_width + 1, width);
+            const double cost = FOURIER_POINT_COST * points * std::log2(points) / outputs;
+            if (best.rows == 0 || cost < best.cost) {
+                best.rows = rows;
+                best.columns = columns;
+                best.cost = cost;
+            }
+            if (columns >= max_columns || points * 2 > FOURIER_MAX_TILE_POINTS) {
+                break;
+            }
+        }
+        if (rows >= max_rows || static_cast<double>(rows) * 2 * min_columns > FOURIER_MAX_TILE_POINTS) {
+            break;
+        }
+    }
+    return best;
+}
+
+// A kernel prepared for overlap-add FFT convolution: the transforms of one tiling and the
+// spectrum of the flipped kernel (so that the tiles are correlated with the kernel as stored),
+// scaled by 1 / (rows * columns) to undo the unscaled inverse transforms. Like a tile in
+// fourier_band, the spectrum is stored row-major, rows of get_bins() bins.
+class FourierKernel {
+private:
+    int kernel_width, kernel_height;
+    FourierTransform row_transform, column_transform;
+    std::vector<std::complex<double> > spectrum;
+
+public:
+    FourierKernel(const ConvolutionKernel& kernel, const FourierTiling& tiling)
+            : kernel_width(kernel.get_width()), kernel_height(kernel.get_height()),
+              row_transform(tiling.columns), column_transform(tiling.rows) {
+        const int bins = get_bins();
+        spectrum.resize(static_cast<size_t>(get_rows()) * bins);
+        std::vector<double> line(tiling.columns, 0.0);
+        for (int i = 0; i < kernel_height; ++i) {
+            for (int j = 0; j < kernel_width; ++j) {
+                line[j] = kernel.get_weight(kernel_height - 1 - i, kernel_width - 1 - j);
+            }
+            row_transform.forward_real(&line[0], &spectrum[static_cast<size_t>(i) * bins]);
+        }
+        column_transform.forward(&spectrum[0], bins);
+
+        const double scale = 1.0 / (static_cast<double>(tiling.rows) * tiling.columns);
+        for (size_t k = 0; k < spectrum.size(); ++k) {
+            spectrum[k] *= scale;
+        }
+    }
+
+    int get_rows() const { return column_transform.get_size(); }
+    int get_columns() const { return row_transform.get_size(); }
+    int get_bins() const { return get_columns() / 2 + 1; }      // Bins of a real row transform
+
+    // Source rows and columns a tile takes
+    int get_tile_rows() const { return get_rows() - kernel_height + 1; }
+    int get_tile_columns() const { return get_columns() - kernel_width + 1; }
+
+    const FourierTransform& get_row_transform() const { return row_transform; }
+    const FourierTransform& get_column_transform() const { return column_transform; }
+    const std::complex<double>* get_spectrum() const { return &spectrum[0]; }
+};
+
+// FFT convolution over the output rows of one band, by overlap-add. The band's source rows,
+// from radius_y above it to radius_y below it, are taken in strips of tile rows, and each strip
+// is cut into tiles of tile columns of the source row extended by the border mode. Every tile
+// is transformed, multiplied by the kernel spectrum and transformed back, which gives its full
+// linear convolution (tile size + kernel size - 1 in each direction); these are added up in an
+// accumulator of tile rows + kernel height - 1 output rows. After a strip, the top tile rows of
+// the accumulator get no more contributions, so they are finished and written out, and the
+// remaining rows move up. Scratch memory therefore depends on the tile and the image width only.
+template <typename Pixel, typename RowWriter>
+static void fourier_band(const BasicImageView<Pixel>& image, const RowBand<Pixel>& band,
+                         const ConvolutionKernel& kernel, const FourierKernel& fourier, Filter::BorderMode border,
+                         const std::vector<std::vector<Pixel> >& border_rows, RowWriter write_row) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius_x = kernel.get_radius_x();
+    const int radius = kernel.get_radius_y();
+    const int padded_width = width + 2 * radius_x;
+    const int rows = fourier.get_rows();
+    const int columns = fourier.get_columns();
+    const int bins = fourier.get_bins();
+    const int tile_rows = fourier.get_tile_rows();
+    const int tile_columns = fourier.get_tile_columns();
+    const int result_rows = tile_rows + kernel.get_height() - 1;
+    const int result_columns = tile_columns + kernel.get_width() - 1;
+
+    double norm = 0.0;
+    for (size_t k = 0; k < kernel.get_weights().size(); ++k) {
+        norm += std::fabs(kernel.get_weights()[k]);
+    }
+    const double snap_tolerance = FOURIER_SNAP_TOLERANCE * norm * snap_range(static_cast<const Pixel*>(nullptr));
+
+    std::vector<Pixel> strip(static_cast<size_t>(tile_rows) * padded_width);
+    std::vector<const Pixel*> strip_rows(tile_rows);    // nullptr for rows of zeros
+    std::vector<std::complex<double> > tile(static_cast<size_t>(rows) * bins);
+    std::vector<double> line(columns);
+    // accumulator row u is output row strip_first - radius + u
+    std::vector<double> accumulator(static_cast<size_t>(result_rows) * width, 0.0);
+
+    for (int strip_first = band.get_first() - radius; strip_first - radius < band.get_last(); strip_first += tile_rows) {
+        // Source rows below the band + radius only reach rows of the next band
+        bool any_rows = false;
+        for (int u = 0; u < tile_rows; ++u) {
+            const int r = strip_first + u;
+            strip_rows[u] = nullptr;
+            if (r >= band.get_last() + radius) {
+                continue;
+            }
+            if (r >= 0 && r < height) {
+                pad_row(band.get_source_row(r), width, radius_x, border, &strip[static_cast<size_t>(u) * padded_width]);
+                strip_rows[u] = &strip[static_cast<size_t>(u) * padded_width];
+            } else {
+                const int mapped = Filter::border_index(r, height, border);
+                strip_rows[u] = mapped < 0 ? nullptr : &border_rows[mapped][0];
+            }
+            any_rows = any_rows || strip_rows[u] != nullptr;
+        }
+
+        for (int tile_first = 0; any_rows && tile_first < padded_width; tile_first += tile_columns) {
+            const int tile_width = std::min(tile_columns, padded_width - tile_first);
+            for (int u = 0; u < tile_rows; ++u) {
+                std::complex<double>* tile_row = &tile[static_cast<size_t>(u) * bins];
+                if (strip_rows[u] == nullptr) {
+                    std::fill(tile_row, tile_row + bins, std::complex<double>());
+                    continue;
+                }
+                for (int v = 0; v < tile_width; ++v) {
+                    line[v] = strip_rows[u][tile_first + v];
+                }
+                std::fill(line.begin() + tile_width, line.end(), 0.0);
+                fourier.get_row_transform().forward_real(&line[0], tile_row);
+            }
+
+            // The rows below tile_rows are zeros; the columns are transformed all together
+            std::fill(tile.begin() + static_cast<size_t>(tile_rows) * bins, tile.end(), std::complex<double>());
+            fourier.get_column_transform().forward(&tile[0], bins);
+            const std::complex<double>* spectrum = fourier.get_spectrum();
+            for (size_t k = 0; k < tile.size(); ++k) {
+                tile[k] = std::complex<double>(tile[k].real() * spectrum[k].real() - tile[k].imag() * spectrum[k].imag(),
+                                               tile[k].real() * spectrum[k].imag() + tile[k].imag() * spectrum[k].real());
+            }
+            fourier.get_column_transform().inverse(&tile[0], bins);
+
+            // Result column v lands on output column tile_first + v - 2 * radius_x
+            const int v_first = std::max(0, 2 * radius_x - tile_first);
+            const int v_last = std::min(result_columns, width + 2 * radius_x - tile_first);
+            for (int u = 0; u < result_rows; ++u) {
+                fourier.get_row_transform().inverse_real(&tile[static_cast<size_t>(u) * bins], &line[0]);
+                double* out = &accumulator[static_cast<size_t>(u) * width];
+                for (int v = v_first; v < v_last; ++v) {
+                    out[tile_first + v - 2 * radius_x] += line[v];
+                }
+            }
+        }
+
+        for (int u = 0; u < tile_rows; ++u) {
+            const int row = strip_first - radius + u;
+            if (row >= band.get_first() && row < band.get_last()) {
+                double* filtered = &accumulator[static_cast<size_t>(u) * width];
+                for (int c = 0; c < width && snap_tolerance > 0.0; ++c) {
+                    const double nearest = std::floor(filtered[c] + 0.5);
+                    if (std::fabs(filtered[c] - nearest) <= snap_tolerance) {
+                        filtered[c] = nearest;
                     }
-                    gaussian_weighted_matrix_sum += pixel_weight * current_pixel_value;
                 }
+                write_row(band, row, filtered);
             }
-            // GAUSSIAN MATRIX MEAN VALUE
-            image.get_data()[row_index][col_index] =
-                    static_cast<int>(std::floor((gaussian_weighted_matrix_sum / gaussian_weight_sum)));
+        }
+        std::copy(accumulator.begin() + static_cast<size_t>(tile_rows) * width, accumulator.end(), accumulator.begin());
+        std::fill(accumulator.end() - static_cast<size_t>(tile_rows) * width, accumulator.end(), 0.0);
+    }
+}
+
+// FFT convolution, in place like the direct one. The kernel spectrum is computed once and
+// shared by the bands; the rows that taps outside the image map to are padded and copied up
+// front.
+template <typename Pixel, typename RowWriter>
+static void fourier_convolution(const BasicImageView<Pixel>& image, const ConvolutionKernel& kernel,
+                                Filter::BorderMode border, RowWriter write_row) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius_x = kernel.get_radius_x();
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    const FourierKernel fourier(kernel, choose_fourier_tiling(kernel.get_width(), kernel.get_height(), width, height));
+    std::vector<std::vector<Pixel> > border_rows = filter_border_rows<Pixel>(width + 2 * radius_x, height,
+            kernel.get_radius_y(), border,
+            [&](int row, Pixel* out) { pad_row(image.get_row(row), width, radius_x, border, out); });
+
+    std::vector<RowBand<Pixel> > bands = make_bands(image, kernel.get_radius_y());
+    run_bands(bands, [&](const RowBand<Pixel>& band) {
+        fourier_band(image, band, kernel, fourier, border, border_rows, write_row);
+    });
+}
+
+// Horizontal fixed-point pass of one 8-bit source row
+static void gaussian_row_fixed(const uint8_t* source, int width, const std::vector<int16_t>& weights,
+                               Filter::BorderMode border, uint8_t* padded, int16_t* out) {
+    const int taps = static_cast<int>(weights.size());
+    pad_row(source, width, (taps - 1) / 2, border, padded);
+    PixelKernels::convolve_row_fixed(padded, &weights[0], taps, out, width);
+}
+
+// Fixed-point Gaussian over the output rows of one band: gaussian_separable_band with 16-bit
+// weights and a ring of 16-bit horizontal results, the vertical pass writing pixels directly
+static void gaussian_fixed_band(const BasicImageView<uint8_t>& image, const RowBand<uint8_t>& band,
+                                const GaussianKernel& kernel, Filter::BorderMode border,
+                                const std::vector<std::vector<int16_t> >& border_rows) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius = kernel.get_radius();
+    const int taps = 2 * radius + 1;
+    const std::vector<int16_t>& weights = kernel.get_fixed_weights();
+
+    std::vector<uint8_t> padded(width + 2 * radius);
+    std::vector<int16_t> horizontal(static_cast<size_t>(taps) * width);
+    std::vector<int16_t> zeros(width, 0);
+    std::vector<const int16_t*> window_rows(taps);
+
+    int next_source_row = std::max(0, band.get_first() - radius);
+    for (int row = band.get_first(); row < band.get_last(); ++row) {
+        while (next_source_row < height && next_source_row <= row + radius) {
+            gaussian_row_fixed(band.get_source_row(next_source_row), width, weights, border, &padded[0],
+                               &horizontal[static_cast<size_t>(next_source_row % taps) * width]);
+            ++next_source_row;
+        }
+        for (int t = -radius; t <= radius; ++t) {
+            const int16_t* in = tap_row(row + t, width, height, taps, border, horizontal, border_rows);
+            window_rows[t + radius] = in == nullptr ? &zeros[0] : in;
+        }
+        PixelKernels::convolve_column_fixed(&window_rows[0], &weights[0], taps, image.get_row(row), width);
+    }
+}
+
+// Gaussian Smoothing Filter in fixed point (8-bit images): the separable passes with Q14
+// weights, all in integer arithmetic. The horizontal pass keeps 7 fractional bits, rounded to
+// nearest; the vertical pass rounds down like the double paths. Results are typically within
+// one gray level of GAUSSIAN_SEPARABLE, and flat regions stay exactly flat.
+static void gaussian_fixed(const BasicImageView<uint8_t>& image, const GaussianKernel& kernel,
+                           Filter::BorderMode border) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int radius = kernel.get_radius();
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    std::vector<uint8_t> padded(width + 2 * radius);
+    std::vector<std::vector<int16_t> > border_rows = filter_border_rows<int16_t>(width, height, radius, border,
+            [&](int row, int16_t* out) {
+                gaussian_row_fixed(image.get_row(row), width, kernel.get_fixed_weights(), border, &padded[0], out);
+            });
+
+    std::vector<RowBand<uint8_t> > bands = make_bands(image, radius);
+    run_bands(bands, [&](const RowBand<uint8_t>& band) {
+        gaussian_fixed_band(image, band, kernel, border, border_rows);
+    });
+}
+
+// 16-bit and float pixels do not fit the 16-bit intermediates; they take the double path
+template <typename Pixel>
+static void gaussian_fixed(const BasicImageView<Pixel>& image, const GaussianKernel& kernel,
+                           Filter::BorderMode border) {
+    const int width = image.get_width();
+    gaussian_separable(image, kernel, border, [&](const RowBand<Pixel>&, int row, const double* blurred) {
+        store_row(blurred, image.get_row(row), width);
+    });
+}
+
+// Lines the recursive passes filter side by side; the vertical pass reads one cache line of floats
+static const int RECURSIVE_STRIP_COLUMNS = 16;
+
+// Gaussian Smoothing Filter, approximated by the recursive filter: a horizontal pass over every
+// row into a float copy of the image, then a vertical pass over strips of columns. The
+// recursion needs whole columns, so unlike the other paths this one holds one float per
+// pixel. Out-of-image samples follow the border mode up to the filter's padding.
+template <typename Pixel>
+static void gaussian_recursive(const BasicImageView<Pixel>& image, double sigma, Filter::BorderMode border) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    if (width == 0 || height == 0) {
+        return;
+    }
+    const RecursiveGaussian recursive(sigma);
+    const int padding = recursive.get_padding();
+    std::vector<float> horizontal(static_cast<size_t>(width) * height);
+
+    // Rows are filtered in groups too, interleaved like the columns, so that the recursion
+    // runs on several independent lines at once
+    ThreadPool& pool = ThreadPool::shared();
+    const int groups = (height + RECURSIVE_STRIP_COLUMNS - 1) / RECURSIVE_STRIP_COLUMNS;
+    pool.parallel_for(groups, [&](int group) {
+        const int first = group * RECURSIVE_STRIP_COLUMNS;
+        const int count = std::min(RECURSIVE_STRIP_COLUMNS, height - first);
+        // rows[(i + padding) * count + c] is sample i of row first + c
+        std::vector<double> rows(static_cast<size_t>(width + 2 * padding) * count);
+        for (int c = 0; c < count; ++c) {
+            const Pixel* in = image.get_row(first + c);
+            double* out = &rows[c];
+            for (int i = -padding; i < width + padding; ++i) {
+                const int col = i >= 0 && i < width ? i : Filter::border_index(i, width, border);
+                out[static_cast<size_t>(i + padding) * count] = col < 0 ? 0.0 : in[col];
+            }
+        }
+        recursive.filter(&rows[0], width + 2 * padding, count);
+        for (int c = 0; c < count; ++c) {
+            float* out = &horizontal[static_cast<size_t>(first + c) * width];
+            for (int col = 0; col < width; ++col) {
+                out[col] = static_cast<float>(rows[static_cast<size_t>(col + padding) * count + c]);
+            }
+        }
+    });
+
+    const int strips = (width + RECURSIVE_STRIP_COLUMNS - 1) / RECURSIVE_STRIP_COLUMNS;
+    pool.parallel_for(strips, [&](int strip) {
+        const int first = strip * RECURSIVE_STRIP_COLUMNS;
+        const int count = std::min(RECURSIVE_STRIP_COLUMNS, width - first);
+        // columns[(r + padding) * count + c] is sample r of column first + c
+        std::vector<double> columns(static_cast<size_t>(height + 2 * padding) * count);
+        for (int r = -padding; r < height + padding; ++r) {
+            const int row = Filter::border_index(r, height, border);
+            double* out = &columns[static_cast<size_t>(r + padding) * count];
+            const float* in = row < 0 ? nullptr : &horizontal[static_cast<size_t>(row) * width + first];
+            for (int c = 0; c < count; ++c) {
+                out[c] = in == nullptr ? 0.0 : in[c];
+            }
+        }
+        recursive.filter(&columns[0], height + 2 * padding, count);
+        // Results are rounded to float precision, like the horizontal pass, before they are
+        // stored. That also drops the recursion's last-bit error, which would otherwise floor a
+        // flat area of 255 to 254.
+        for (int row = 0; row < height; ++row) {
+            const double* in = &columns[static_cast<size_t>(row + padding) * count];
+            Pixel* out = image.get_row(row) + first;
+            for (int c = 0; c < count; ++c) {
+                out[c] = PixelTraits<Pixel>::from_double(static_cast<float>(in[c]));
+            }
+        }
+    });
+}
+
+// Box blurs GAUSSIAN_BOX applies one after the other
+static const int BOX_GAUSSIAN_PASSES = 3;
+
+// Radii of passes boxes whose combined variance, the sum of (w^2 - 1) / 12 over the widths w,
+// is as close to sigma^2 as odd widths allow (Kovesi, "Fast Almost-Gaussian Filtering"): the
+// first m boxes are w wide and the others w + 2
+static std::vector<int> box_radii(double sigma, int passes) {
+    const double ideal_width = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+    int width = static_cast<int>(std::floor(ideal_width));
+    if (width % 2 == 0) {
+        --width;
+    }
+    width = std::max(width, 1);
+    const double ideal_m = (12.0 * sigma * sigma - passes * width * width - 4.0 * passes * width - 3.0 * passes)
+                           / (-4.0 * width - 4.0);
+    const int m = std::max(0, std::min(passes, static_cast<int>(std::floor(ideal_m + 0.5))));
+
+    std::vector<int> radii(passes);
+    for (int p = 0; p < passes; ++p) {
+        radii[p] = ((p < m ? width : width + 2) - 1) / 2;
+    }
+    return radii;
+}
+
+// GAUSSIAN_BOX falls back to GAUSSIAN_SEPARABLE when the variance of its boxes is further than
+// this fraction from sigma^2
+static const double BOX_MAX_VARIANCE_ERROR = 0.15;
+
+// True if the box cascade is a fair stand-in for a Gaussian of this sigma: every pass is a real
+// box (at least 3 wide) and the variance of the cascade is within BOX_MAX_VARIANCE_ERROR of
+// sigma^2. Below sigma 1.3 some of the boxes are 1 wide and the cascade is far from Gaussian
+// (at sigma 1 it is a single 3-wide box); up to sigma 2 the odd widths can miss sigma^2 by
+// 20% and more. From sigma 2 on it always fits.
+static bool box_fits_sigma(double sigma) {
+    const std::vector<int> radii = box_radii(sigma, BOX_GAUSSIAN_PASSES);
+    double variance = 0.0;
+    for (size_t p = 0; p < radii.size(); ++p) {
+        if (radii[p] == 0) {
+            return false;
+        }
+        variance += ((2.0 * radii[p] + 1) * (2.0 * radii[p] + 1) - 1.0) / 12.0;
+    }
+    return std::fabs(variance - sigma * sigma) <= BOX_MAX_VARIANCE_ERROR * sigma * sigma;
+}
+
+// Horizontal passes of the box cascade over one source row: the row is padded by the sum of
+// the radii and box-summed once per radius, every pass leaving 2 * radius fewer values.
+// scratch holds two rows of width + 2 * reach sums.
+template <typename Pixel, typename Sum>
+static void box_cascade_row(const Pixel* source, int width, const std::vector<int>& radii, int reach,
+                            Filter::BorderMode border, Pixel* padded, Sum* scratch, Sum* out) {
+    pad_row(source, width, reach, border, padded);
+    int n = width + 2 * reach;
+    const Sum* in = nullptr;
+    for (size_t p = 0; p < radii.size(); ++p) {
+        const int taps = 2 * radii[p] + 1;
+        Sum* sums = p + 1 == radii.size() ? out : scratch + (p % 2) * (width + 2 * reach);
+        n -= taps - 1;
+        if (p == 0) {
+            running_sum(padded, n, taps, sums);
+        } else {
+            running_sum(in, n, taps, sums);
+        }
+        in = sums;
+    }
+}
+
+// sum / divisor rounded down, for a non-negative sum. A 64-bit division per pixel would cost
+// more than all the box passes together, so the quotient is estimated from the reciprocal in
+// double precision, which is off by at most one, and then corrected.
+static int64_t divide_sum(int64_t sum, int64_t divisor, double reciprocal) {
+    int64_t quotient = static_cast<int64_t>(static_cast<double>(sum) * reciprocal);
+    if (quotient * divisor > sum) {
+        --quotient;
+    } else if ((quotient + 1) * divisor <= sum) {
+        ++quotient;
+    }
+    return quotient;
+}
+
+static double divide_sum(double sum, double divisor, double) {
+    return sum / divisor;
+}
+
+// Box cascade over the output rows of one band: every row runs through the horizontal boxes,
+// then through one ColumnBoxSum per box, each feeding the next
+template <typename Pixel, typename Sum>
+static void gaussian_box_band(const BasicImageView<Pixel>& image, const RowBand<Pixel>& band,
+                              const std::vector<int>& radii, Filter::BorderMode border,
+                              const std::vector<std::vector<Sum> >& border_rows, Sum normaliser) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int reach = std::accumulate(radii.begin(), radii.end(), 0);
+    const double reciprocal = 1.0 / static_cast<double>(normaliser);
+
+    std::vector<Pixel> padded(width + 2 * reach);
+    std::vector<Sum> scratch(2 * static_cast<size_t>(width + 2 * reach));
+    std::vector<ColumnBoxSum<Sum> > passes;
+    for (size_t p = 0; p < radii.size(); ++p) {
+        passes.push_back(ColumnBoxSum<Sum>(width, 2 * radii[p] + 1));
+    }
+
+    // Row e enters the first pass; once every pass is full, the last one has produced row e - reach.
+    for (int entering = band.get_first() - reach; entering < band.get_last() + reach; ++entering) {
+        Sum* row = passes[0].begin_row();
+        if (entering >= 0 && entering < height) {
+            box_cascade_row(band.get_source_row(entering), width, radii, reach, border, &padded[0], &scratch[0], row);
+        } else {
+            copy_border_row(entering, width, height, border, border_rows, row);
+        }
+        const Sum* sums = passes[0].end_row();
+        for (size_t p = 1; p < passes.size() && sums != nullptr; ++p) {
+            std::memcpy(passes[p].begin_row(), sums, sizeof(Sum) * width);
+            sums = passes[p].end_row();
+        }
+
+        if (sums != nullptr) {
+            Pixel* out = image.get_row(entering - reach);
+            for (int col = 0; col < width; ++col) {
+                out[col] = static_cast<Pixel>(divide_sum(sums[col], normaliser, reciprocal));
+            }
+        }
+    }
+}
+
+// Gaussian Smoothing Filter, approximated by BOX_GAUSSIAN_PASSES box blurs in a row, each of
+// them a horizontal and a vertical pass of running sums, so the cost per pixel does not depend
+// on sigma. The boxes see the border-extended image, like the exact kernel does. Integer pixels
+// are summed exactly in 64 bits and divided once at the end, so the result is the exact iterated
+// box blur rounded down.
+template <typename Pixel>
+static void gaussian_box(const BasicImageView<Pixel>& image, double sigma, Filter::BorderMode border) {
+    const int width = image.get_width();
+    const int height = image.get_height();
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    typedef typename std::conditional<PixelTraits<Pixel>::is_integer, int64_t, double>::type Sum;
+    const std::vector<int> radii = box_radii(sigma, BOX_GAUSSIAN_PASSES);
+    const int reach = std::accumulate(radii.begin(), radii.end(), 0);
+    double area = 1.0;
+    for (size_t p = 0; p < radii.size(); ++p) {
+        area *= 2 * radii[p] + 1;
+    }
+    // Largest sum: a 16-bit pixel times the weight of the whole 2D kernel
+    if (65535.0 * area * area >= 9.0e18) {
+        throw std::invalid_argument("Sigma is too large for GAUSSIAN_BOX; use GAUSSIAN_RECURSIVE.");
+    }
+    const Sum normaliser = static_cast<Sum>(area * area);
+
+    std::vector<Pixel> padded(width + 2 * reach);
+    std::vector<Sum> scratch(2 * static_cast<size_t>(width + 2 * reach));
+    std::vector<std::vector<Sum> > border_rows = filter_border_rows<Sum>(width, height, reach, border,
+            [&](int row, Sum* out) {
+                box_cascade_row(image.get_row(row), width, radii, reach, border, &padded[0], &scratch[0], out);
+            });
+
+    std::vector<RowBand<Pixel> > bands = make_bands(image, reach);
+    run_bands(bands, [&](const RowBand<Pixel>& band) {
+        gaussian_box_band(image, band, radii, border, border_rows, normaliser);
+    });
+}
+
+// GAUSSIAN_AUTO switches to the recursive approximation from this sigma on (kernels of 49 taps
+// and more), provided the kernel reaches 3 sigma, so that its truncation hardly matters
+static const double RECURSIVE_MIN_SIGMA = 8.0;
+
+Filter::GaussianMode Filter::choose_gaussian_mode(int kernelSize, double sigma) {
+    if (kernelSize <= 1) {
+        return GAUSSIAN_DIRECT;
+    }
+    if (sigma >= RECURSIVE_MIN_SIGMA && (kernelSize - 1) / 2 >= 3.0 * sigma) {
+        return GAUSSIAN_RECURSIVE;
+    }
+    return GAUSSIAN_SEPARABLE;
+}
+
+// Compares the 2D impulse responses: the recursive one is measured by filtering a unit impulse
+// exactly as gaussian_recursive filters a row (zero border), far enough out that its tail is lost
+// in rounding; the exact one is the outer product of the normalised 1D kernel with itself
+double Filter::get_recursive_gaussian_error(int kernelSize, double sigma) {
+    std::shared_ptr<const GaussianKernel> kernel = GaussianKernel::get(kernelSize, sigma);
+    const RecursiveGaussian recursive(sigma);
+    const int radius = kernel->get_radius();
+    const int padding = recursive.get_padding();
+    const int reach = std::max(radius, 2 * padding);
+    const int taps = 2 * reach + 1;
+
+    std::vector<double> line(taps + 2 * padding, 0.0);
+    line[padding + reach] = 1.0;
+    recursive.filter(&line[0], static_cast<int>(line.size()), 1);
+    std::vector<double> exact(taps, 0.0);
+    for (int t = -radius; t <= radius; ++t) {
+        exact[reach + t] = kernel->get_weights()[t + radius];
+    }
+
+    double error = 0.0;
+    for (int i = 0; i < taps; ++i) {
+        for (int j = 0; j < taps; ++j) {
+            error += std::fabs(line[padding + i] * line[padding + j] - exact[i] * exact[j]);
         }
     }
+    return 255.0 * error;
+}
+
+// Gaussian Smoothing Filter
+template <typename Pixel>
+void Filter::apply_gaussian_smoothing(const BasicImageView<Pixel>& image, int kernelSize, double sigma,
+                                      GaussianMode mode, BorderMode border) {
+    // The separable pass costs 2k instead of k^2 taps per pixel, so it is preferred unless the
+    // caller explicitly asks for the reference 2D convolution, or sigma is so large that the
+    // recursive approximation's constant cost wins (see choose_gaussian_mode).
+    if (mode == GAUSSIAN_AUTO) {
+        mode = choose_gaussian_mode(kernelSize, sigma);
+    }
+    if (mode == GAUSSIAN_RECURSIVE) {
+        gaussian_recursive(image, sigma, border);
+        return;
+    }
+    if (mode == GAUSSIAN_BOX && !box_fits_sigma(sigma)) {
+        mode = GAUSSIAN_SEPARABLE;
+    }
+    if (mode == GAUSSIAN_BOX) {
+        gaussian_box(image, sigma, border);
+        return;
+    }
+
+    // Weights come from the shared cache, so exp() runs once per (kernelSize, sigma) per process.
+    std::shared_ptr<const GaussianKernel> kernel = GaussianKernel::get(kernelSize, sigma);
+    const int width = image.get_width();
+    auto store_blurred = [&](const RowBand<Pixel>&, int row, const double* blurred) {
+        store_row(blurred, image.get_row(row), width);
+    };
+    if (mode == GAUSSIAN_SEPARABLE) {
+        gaussian_separable(image, *kernel, border, store_blurred);
+    } else if (mode == GAUSSIAN_FIXED_POINT) {
+        gaussian_fixed(image, *kernel, border);
+    } else {
+        gaussian_direct(image, *kernel, border, store_blurred);
+    }
 }
 
 // Unsharp Masking Filter
-void Filter::apply_unsharp_mask(GrayscaleImage& image, int kernelSize, double amount) {
+template <typename Pixel>
+void Filter::apply_unsharp_mask(const BasicImageView<Pixel>& image, int kernelSize, double amount, BorderMode border) {
     // 1. Blur the image using Gaussian smoothing, use the default sigma given in the header.
     // 2. For each pixel, apply the unsharp mask formula: original + amount * (original - blurred).
-    // 3. Clip values to ensure they are within a valid range [0-255].
-
-    GrayscaleImage reference(image);
-    apply_gaussian_smoothing(image, kernelSize, 1.0);
-    double unsharp_mask_output;
-    for (int i = 0; i < image.get_height(); ++i) {
-        for (int j = 0; j < image.get_width(); ++j) {
-            unsharp_mask_output = reference.get_pixel(i,j) + amount
-                    * (reference.get_pixel(i,j) - image.get_pixel(i,j));
-            if (unsharp_mask_output < 0){
-                image.set_pixel(i, j, 0);
-            } else if (unsharp_mask_output > 255){
-                image.set_pixel(i, j, 255);
-            } else {
-                image.set_pixel(i, j, unsharp_mask_output);
-            }
-        }
+    // 3. Clip values to ensure they are within a valid range ([0-255] for 8-bit pixels).
+    // All three steps are fused into the Gaussian pass: each blurred row only exists as the
+    // pass's double row, is rounded to a pixel value exactly as the stored blur would be, and is
+    // combined at once with the original row, which the band still holds at that point. The
+    // image is read and written once; nothing is copied.
+
+    // The same choice of Gaussian as apply_gaussian_smoothing's GAUSSIAN_AUTO; with sigma 1 it
+    // never picks the recursive approximation
+    std::shared_ptr<const GaussianKernel> kernel = GaussianKernel::get(kernelSize, 1.0);
+    const int width = image.get_width();
+    auto sharpen = [&](const RowBand<Pixel>& band, int row, const double* blurred) {
+        unsharp_row(band.get_source_row(row), blurred, amount, image.get_row(row), width);
+    };
+    if (kernelSize > 1) {
+        gaussian_separable(image, *kernel, border, sharpen);
+    } else {
+        gaussian_direct(image, *kernel, border, sharpen);
     }
 }
+
+Filter::ConvolutionMode Filter::choose_convolution_mode(const ConvolutionKernel& kernel, int width, int height) {
+    const double direct = static_cast<double>(kernel.get_width()) * kernel.get_height();
+    const double separable = kernel.is_separable() ? kernel.get_width() + kernel.get_height() : direct;
+    const double fourier = choose_fourier_tiling(kernel.get_width(), kernel.get_height(),
+                                                 std::max(1, width), std::max(1, height)).cost;
+    if (fourier < std::min(direct, separable)) {
+        return CONVOLUTION_FFT;
+    }
+    return separable < direct ? CONVOLUTION_SEPARABLE : CONVOLUTION_DIRECT;
+}
+
+// Convolution with a user-defined kernel
+template <typename Pixel>
+void Filter::convolve(const BasicImageView<Pixel>& image, const ConvolutionKernel& kernel, BorderMode border,
+                      ConvolutionMode mode) {
+    const int width = image.get_width();
+    auto store_filtered = [&](const RowBand<Pixel>&, int row, const double* filtered) {
+        store_row(filtered, image.get_row(row), width);
+    };
+    if (mode == CONVOLUTION_AUTO) {
+        mode = choose_convolution_mode(kernel, width, image.get_height());
+    }
+    if (mode == CONVOLUTION_FFT) {
+        fourier_convolution(image, kernel, border, store_filtered);
+    } else if (mode == CONVOLUTION_SEPARABLE && kernel.is_separable()) {
+        separable_convolution(image, kernel.get_row_factor(), kernel.get_column_factor(), border, store_filtered);
+    } else {
+        direct_convolution(image, kernel, border, store_filtered);
+    }
+}
+
+// The filters are compiled for every pixel type here
+#define CLEARVISION_INSTANTIATE_FILTERS(Pixel)                                                                  \
+    template void Filter::apply_mean_filter<Pixel>(const BasicImageView<Pixel>&, int, BorderMode);            \
+    template void Filter::apply_gaussian_smoothing<Pixel>(const BasicImageView<Pixel>&, int, double,          \
+                                                          GaussianMode, BorderMode);                          \
+    template void Filter::apply_unsharp_mask<Pixel>(const BasicImageView<Pixel>&, int, double, BorderMode);   \
+    template void Filter::convolve<Pixel>(const BasicImageView<Pixel>&, const ConvolutionKernel&, BorderMode, \
+                                          ConvolutionMode);
+
+CLEARVISION_INSTANTIATE_FILTERS(uint8_t)
+CLEARVISION_INSTANTIATE_FILTERS(uint16_t)
+CLEARVISION_INSTANTIATE_FILTERS(float)
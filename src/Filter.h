@@ -1,18 +1,126 @@
 #ifndef FILTER_H
 #define FILTER_H
 
+#include "ConvolutionKernel.h"
 #include "GrayscaleImage.h"
+#include "ImageView.h"
 
 class Filter {
 public:
+    // How apply_gaussian_smoothing evaluates the kernel
+    enum GaussianMode {
+        GAUSSIAN_AUTO,        // Pick the fastest implementation for the kernel
+        GAUSSIAN_DIRECT,      // Full k x k 2D convolution, k^2 taps per pixel
+        GAUSSIAN_SEPARABLE,   // Horizontal then vertical 1D pass, 2k taps per pixel
+        GAUSSIAN_RECURSIVE,   // Recursive approximation of the untruncated Gaussian, constant cost per pixel
+        GAUSSIAN_BOX,         // Three box blurs of about the same variance, constant cost per pixel (previews, sigma >= 2)
+        GAUSSIAN_FIXED_POINT  // Separable passes in 16-bit integer arithmetic (8-bit images; others use SEPARABLE)
+    };
+
+    // How convolve evaluates a user-defined kernel
+    enum ConvolutionMode {
+        CONVOLUTION_AUTO,       // Pick the fastest implementation for the kernel and image size
+        CONVOLUTION_DIRECT,     // Full w x h 2D convolution, w * h taps per pixel
+        CONVOLUTION_SEPARABLE,  // Horizontal then vertical 1D pass, w + h taps per pixel (separable kernels; others use DIRECT)
+        CONVOLUTION_FFT         // Overlap-add FFT tiles, cost per pixel about log2 of the tile size (large kernels)
+    };
+
+    // Value of the pixels a kernel reaches outside the image (shown for a row "abcd")
+    enum BorderMode {
+        BORDER_ZERO,          // 000|abcd|000, the original behaviour
+        BORDER_REPLICATE,     // aaa|abcd|ddd
+        BORDER_REFLECT,       // cba|abcd|dcb, mirrored with the edge pixel repeated
+        BORDER_WRAP           // bcd|abcd|abc, the image tiles periodically
+    };
+
+    // The filters work on images and views of every pixel type (uint8_t, uint16_t, float).
+    // Integer results are rounded down into the pixel range; float results are kept as they are.
+
     // Apply the Mean Filter
-    static void apply_mean_filter(GrayscaleImage& image, int kernelSize = 3);
+    // The divisor is kernelSize * kernelSize everywhere, whatever the border mode.
+    template <typename Pixel>
+    static void apply_mean_filter(BasicGrayscaleImage<Pixel>& image, int kernelSize = 3,
+                                  BorderMode border = BORDER_ZERO) {
+        apply_mean_filter(image.view(), kernelSize, border);
+    }
 
     // Apply Gaussian Smoothing Filter
-    static void apply_gaussian_smoothing(GrayscaleImage& image, int kernelSize = 3, double sigma = 1.0);
+    // The separable path matches the direct one except where the exact result lies within
+    // double rounding error of an integer, where the floor may differ by 1; it reproduces
+    // every sample_io/gauss and sample_io/unsharp output bit for bit.
+    // GAUSSIAN_RECURSIVE and GAUSSIAN_BOX only use sigma. GAUSSIAN_BOX runs GAUSSIAN_SEPARABLE
+    // with kernelSize unless its boxes are all at least 3 wide with a variance within 15% of
+    // sigma^2, and throws std::invalid_argument for sigmas above about 100.
+    // GAUSSIAN_FIXED_POINT rounds the weights to multiples of 2^-14 and the horizontal pass to
+    // multiples of 2^-7; on natural 8-bit images it stays within 1 gray level of GAUSSIAN_SEPARABLE.
+    template <typename Pixel>
+    static void apply_gaussian_smoothing(BasicGrayscaleImage<Pixel>& image, int kernelSize = 3, double sigma = 1.0,
+                                         GaussianMode mode = GAUSSIAN_AUTO, BorderMode border = BORDER_ZERO) {
+        apply_gaussian_smoothing(image.view(), kernelSize, sigma, mode, border);
+    }
+
+    // Implementation GAUSSIAN_AUTO picks: GAUSSIAN_RECURSIVE for sigma >= 8 when the kernel
+    // reaches at least 3 sigma from its centre, otherwise GAUSSIAN_SEPARABLE (GAUSSIAN_DIRECT
+    // for a 1x1 kernel)
+    static GaussianMode choose_gaussian_mode(int kernelSize, double sigma);
+
+    // Accuracy of GAUSSIAN_RECURSIVE against the exact kernel: the most, in gray levels of an
+    // 8-bit image, by which its result can differ from GAUSSIAN_SEPARABLE's before rounding
+    // (255 times the L1 norm of the difference of the 2D impulse responses). Natural images stay
+    // well below this bound. Takes O(max(kernelSize, 16 sigma)^2) time.
+    static double get_recursive_gaussian_error(int kernelSize, double sigma);
 
     // Apply Unsharp Masking Filter
-    static void apply_unsharp_mask(GrayscaleImage& image, int kernelSize = 3, double amount = 1.5);
+    template <typename Pixel>
+    static void apply_unsharp_mask(BasicGrayscaleImage<Pixel>& image, int kernelSize = 3, double amount = 1.5,
+                                   BorderMode border = BORDER_ZERO) {
+        apply_unsharp_mask(image.view(), kernelSize, amount, border);
+    }
+
+    // Convolve with a user-defined kernel: each pixel becomes the sum over the kernel of
+    // kernel.get_weight(i, j) * pixel(row - radius_y + i, col - radius_x + j). The kernel is
+    // applied as stored, not flipped (like most image libraries' filter2D). Signed responses
+    // (Sobel, Laplacian) only survive on float images.
+    // CONVOLUTION_FFT agrees with the direct sums up to double rounding; integer results within
+    // that rounding of a whole number are taken as the whole number before rounding down, so
+    // away from such ties it gives the same pixels. Every border mode is supported.
+    template <typename Pixel>
+    static void convolve(BasicGrayscaleImage<Pixel>& image, const ConvolutionKernel& kernel,
+                         BorderMode border = BORDER_ZERO, ConvolutionMode mode = CONVOLUTION_AUTO) {
+        convolve(image.view(), kernel, border, mode);
+    }
+
+    // Implementation CONVOLUTION_AUTO picks for a width x height image: the one with the fewest
+    // estimated operations per pixel, counting w * h taps for DIRECT, w + h for SEPARABLE
+    // (separable kernels only) and, for FFT, the transform work of the cheapest tiling divided
+    // over the pixels each tile produces.
+    static ConvolutionMode choose_convolution_mode(const ConvolutionKernel& kernel, int width, int height);
+
+    // The same filters applied in place to a view, e.g. a band or region of a larger image.
+    // The view is filtered as if it were a whole image: the border mode applies at its edges.
+    template <typename Pixel>
+    static void apply_mean_filter(const BasicImageView<Pixel>& image, int kernelSize = 3,
+                                  BorderMode border = BORDER_ZERO);
+    template <typename Pixel>
+    static void apply_gaussian_smoothing(const BasicImageView<Pixel>& image, int kernelSize = 3, double sigma = 1.0,
+                                         GaussianMode mode = GAUSSIAN_AUTO, BorderMode border = BORDER_ZERO);
+    template <typename Pixel>
+    static void apply_unsharp_mask(const BasicImageView<Pixel>& image, int kernelSize = 3, double amount = 1.5,
+                                   BorderMode border = BORDER_ZERO);
+    template <typename Pixel>
+    static void convolve(const BasicImageView<Pixel>& image, const ConvolutionKernel& kernel,
+                         BorderMode border = BORDER_ZERO, ConvolutionMode mode = CONVOLUTION_AUTO);
+
+    // Number of threads the filters split the image rows over (bands with halo rows).
+    // <= 0 means one per hardware thread, which is also the default unless the
+    // CLEARVISION_THREADS environment variable says otherwise. Results are bit-identical
+    // for every thread count. Must not be changed while another thread is filtering.
+    static void set_thread_count(int threads);
+    static int get_thread_count();
+
+    // Maps an index outside [0, n) to the index whose pixel the border mode repeats there,
+    // or -1 if that pixel is 0. Indices inside [0, n) are returned unchanged.
+    static int border_index(int index, int n, BorderMode border);
 };
 
 #endif // FILTER_H
@@ -0,0 +1,157 @@
+#include "FourierTransform.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <math.h>
+
+// a * b, spelled out: std::complex's operator* checks for infinities and is much slower
+static inline std::complex<double> multiply(const std::complex<double>& a, const std::complex<double>& b) {
+    return std::complex<double>(a.real() * b.real() - a.imag() * b.imag(),
+                                a.real() * b.imag() + a.imag() * b.real());
+}
+
+FourierTransform::FourierTransform(int size) : size(size) {
+    if (size < 2 || (size & (size - 1)) != 0) {
+        throw std::invalid_argument("Transform size must be a power of two, at least 2.");
+    }
+    twiddles.resize(size / 2);
+    for (int k = 0; k < size / 2; ++k) {
+        const double angle = -2.0 * M_PI * k / size;
+        twiddles[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+    }
+}
+
+int FourierTransform::next_power_of_two(int n) {
+    int power = 1;
+    while (power < n) {
+        power *= 2;
+    }
+    return power;
+}
+
+// Iterative decimation in time: the values in bit-reversed order, then butterflies of length
+// 2, 4, ..., n. A transform of length L uses every (size / L)-th twiddle, so a half-size
+// transform (for the real transforms) shares the table. Interleaved sequences go through every
+// butterfly together, which keeps the memory accesses sequential.
+void FourierTransform::transform(std::complex<double>* data, int n, int count, bool inverse) const {
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap_ranges(data + static_cast<size_t>(i) * count, data + static_cast<size_t>(i + 1) * count,
+                             data + static_cast<size_t>(j) * count);
+        }
+    }
+
+    const double sign = inverse ? -1.0 : 1.0;     // The inverse uses the conjugate twiddles
+    if (count == 1) {
+        // Lengths 2 and 4 together: their twiddles are 1 and -i (i for the inverse)
+        if (n >= 4) {
+            for (int start = 0; start < n; start += 4) {
+                std::complex<double>* d = data + start;
+                const std::complex<double> s0 = d[0] + d[1];
+                const std::complex<double> d0 = d[0] - d[1];
+                const std::complex<double> s1 = d[2] + d[3];
+                const std::complex<double> d1 = d[2] - d[3];
+                const std::complex<double> rotated(sign * d1.imag(), -sign * d1.real());     // -i * d1 forwards
+                d[0] = s0 + s1;
+                d[2] = s0 - s1;
+                d[1] = d0 + rotated;
+                d[3] = d0 - rotated;
+            }
+        }
+        for (int length = n >= 4 ? 8 : 2; length <= n; length *= 2) {
+            const int half = length / 2;
+            const int step = size / length;
+            for (int start = 0; start < n; start += length) {
+                std::complex<double>* a = data + start;
+                std::complex<double>* b = data + start + half;
+                for (int m = 0; m < half; ++m) {
+                    const std::complex<double> w(twiddles[m * step].real(), sign * twiddles[m * step].imag());
+                    const std::complex<double> t = multiply(w, b[m]);
+                    b[m] = a[m] - t;
+                    a[m] += t;
+                }
+            }
+        }
+        return;
+    }
+
+    for (int length = 2; length <= n; length *= 2) {
+        const int half = length / 2;
+        const int step = size / length;
+        for (int m = 0; m < half; ++m) {
+            const std::complex<double> w(twiddles[m * step].real(), sign * twiddles[m * step].imag());
+            for (int start = m; start < n; start += length) {
+                std::complex<double>* a = data + static_cast<size_t>(start) * count;
+                std::complex<double>* b = data + static_cast<size_t>(start + half) * count;
+                for (int c = 0; c < count; ++c) {
+                    const std::complex<double> t = multiply(w, b[c]);
+                    b[c] = a[c] - t;
+                    a[c] += t;
+                }
+            }
+        }
+    }
+}
+
+void FourierTransform::forward(std::complex<double>* data, int count) const {
+    transform(data, size, count, false);
+}
+
+void FourierTransform::inverse(std::complex<double>* data, int count) const {
+    transform(data, size, count, true);
+}
+
+// The even and odd samples are packed into one complex signal z of size / 2 values and
+// transformed together. With a = Z[k] and b = conj(Z[size / 2 - k]), the transforms of the even
+// and odd samples are E = (a + b) / 2 and O = (a - b) / 2i, and X[k] = E + W^k O. Bin
+// size / 2 - k then follows from the same E and O as conj(E - W^k O).
+void FourierTransform::forward_real(const double* in, std::complex<double>* out) const {
+    const int half = size / 2;
+    for (int k = 0; k < half; ++k) {
+        out[k] = std::complex<double>(in[2 * k], in[2 * k + 1]);
+    }
+    transform(out, half, 1, false);
+
+    const std::complex<double> z0 = out[0];
+    out[0] = std::complex<double>(z0.real() + z0.imag(), 0.0);
+    out[half] = std::complex<double>(z0.real() - z0.imag(), 0.0);
+    for (int k = 1; 2 * k <= half; ++k) {
+        const std::complex<double> a = out[k];
+        const std::complex<double> b = std::conj(out[half - k]);
+        const std::complex<double> even = 0.5 * (a + b);
+        const std::complex<double> difference = 0.5 * (a - b);
+        const std::complex<double> odd(difference.imag(), -difference.real());    // difference / i
+        const std::complex<double> twisted = multiply(twiddles[k], odd);
+        out[k] = even + twisted;
+        out[half - k] = std::conj(even - twisted);
+    }
+}
+
+// forward_real run backwards: E and O from X[k] and conj(X[size / 2 - k]), Z[k] = E + i O, then
+// the half-size inverse. E and O are not halved, which scales the result by size.
+void FourierTransform::inverse_real(std::complex<double>* in, double* out) const {
+    const int half = size / 2;
+    const double x0 = in[0].real();
+    const double x_half = in[half].real();
+    in[0] = std::complex<double>(x0 + x_half, x0 - x_half);
+    for (int k = 1; 2 * k <= half; ++k) {
+        const std::complex<double> a = in[k];
+        const std::complex<double> b = std::conj(in[half - k]);
+        const std::complex<double> even = a + b;
+        const std::complex<double> odd = multiply(a - b, std::conj(twiddles[k]));
+        const std::complex<double> i_odd(-odd.imag(), odd.real());
+        in[k] = even + i_odd;
+        in[half - k] = std::conj(even - i_odd);
+    }
+    transform(in, half, 1, true);
+    for (int k = 0; k < half; ++k) {
+        out[2 * k] = in[k].real();
+        out[2 * k + 1] = in[k].imag();
+    }
+}
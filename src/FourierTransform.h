@@ -0,0 +1,46 @@
+#ifndef FOURIER_TRANSFORM_H
+#define FOURIER_TRANSFORM_H
+
+#include <complex>
+#include <vector>
+
+// Radix-2 fast Fourier transform of a fixed power-of-two size, for complex data and for real
+// data (as a complex transform of half the size). The inverse transforms are not scaled, so
+// inverse(forward(x)) = size * x. A transform object only holds its twiddle factors, so one
+// object can be used from several threads at once.
+class FourierTransform {
+private:
+    int size;
+    std::vector<std::complex<double> > twiddles;    // exp(-2 pi i k / size) for k < size / 2
+
+    // In-place transform of count interleaved sequences of n values, n a power of two dividing size
+    void transform(std::complex<double>* data, int n, int count, bool inverse) const;
+
+public:
+    // Constructor: size must be a power of two, at least 2; throws std::invalid_argument otherwise
+    explicit FourierTransform(int size);
+
+    int get_size() const { return size; }
+
+    // Smallest power of two that is at least n (n >= 1)
+    static int next_power_of_two(int n);
+
+    // X[k] = sum over j of x[j] * exp(-2 pi i j k / size), in place on size values. With count > 1
+    // it transforms count interleaved sequences at once: value j of sequence c is
+    // data[j * count + c], so e.g. the columns of a row-major array are transformed row by row.
+    void forward(std::complex<double>* data, int count = 1) const;
+
+    // x[j] = sum over k of X[k] * exp(2 pi i j k / size), in place on size values (or count
+    // interleaved sequences, like forward)
+    void inverse(std::complex<double>* data, int count = 1) const;
+
+    // Forward transform of size real samples: the size / 2 + 1 non-redundant bins X[0..size / 2]
+    // (the others are their conjugates)
+    void forward_real(const double* in, std::complex<double>* out) const;
+
+    // Inverse of forward_real: size real samples from size / 2 + 1 bins, unscaled like inverse.
+    // in is used as scratch space and overwritten.
+    void inverse_real(std::complex<double>* in, double* out) const;
+};
+
+#endif // FOURIER_TRANSFORM_H
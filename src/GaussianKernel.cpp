@@ -0,0 +1,93 @@
+#include "GaussianKernel.h"
+#include "PixelKernels.h"
+#include <cmath>
+#include <list>
+#include <map>
+#include <utility>
+#include <math.h>
+
+// Constructor: evaluate and normalise the 1D kernel
+GaussianKernel::GaussianKernel(int kernelSize, double sigma)
+        : size(kernelSize), radius((kernelSize - 1) / 2), sigma(sigma), weight_sum_2d(0) {
+    const int taps = 2 * radius + 1;
+    weights.resize(taps);
+
+    double weight_sum = 0;
+    for (int t = -radius; t <= radius; ++t) {
+        weights[t + radius] = exp(-((t * t) / (2 * sigma * sigma)));
+        weight_sum += weights[t + radius];
+    }
+    for (int t = 0; t < taps; ++t) {
+        weights[t] /= weight_sum;
+    }
+
+    // Fixed-point copy; a flat image must stay flat, so the weights have to add up to exactly one
+    const long one = 1L << PixelKernels::FIXED_WEIGHT_BITS;
+    fixed_weights.resize(taps);
+    long fixed_sum = 0;
+    for (int t = 0; t < taps; ++t) {
+        fixed_weights[t] = static_cast<int16_t>(lround(weights[t] * one));
+        fixed_sum += fixed_weights[t];
+    }
+    fixed_weights[radius] = static_cast<int16_t>(fixed_weights[radius] + (one - fixed_sum));
+}
+
+// Evaluate the 2D kernel with the same expression and summation order the direct filter always used
+void GaussianKernel::build_weights_2d() const {
+    const int taps = 2 * radius + 1;
+    weights_2d.resize(static_cast<size_t>(taps) * taps);
+
+    double pixel_weight;
+    weight_sum_2d = 0;
+    for (int i = -radius; i <= radius; ++i) {
+        for (int j = -radius; j <= radius; ++j) {
+            pixel_weight = (exp(-((i*i + j*j)/(2*sigma*sigma)))) / (2*M_PI*sigma*sigma);
+            weights_2d[(i + radius) * taps + (j + radius)] = pixel_weight;
+            weight_sum_2d += pixel_weight;
+        }
+    }
+}
+
+const std::vector<double>& GaussianKernel::get_weights_2d() const {
+    std::call_once(weights_2d_built, &GaussianKernel::build_weights_2d, this);
+    return weights_2d;
+}
+
+double GaussianKernel::get_weight_sum_2d() const {
+    std::call_once(weights_2d_built, &GaussianKernel::build_weights_2d, this);
+    return weight_sum_2d;
+}
+
+// Process-wide cache, keyed by (kernelSize, sigma). The list holds the kernels from most to least
+// recently used, and the map points into it, so a hit moves its entry to the front and a miss
+// past CACHE_CAPACITY drops the entry at the back.
+typedef std::pair<int, double> CacheKey;
+typedef std::list<std::pair<CacheKey, std::shared_ptr<const GaussianKernel> > > CacheList;
+static std::mutex cache_mutex;
+static CacheList cache_list;
+static std::map<CacheKey, CacheList::iterator> cache;
+
+std::shared_ptr<const GaussianKernel> GaussianKernel::get(int kernelSize, double sigma) {
+    const CacheKey key(kernelSize, sigma);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    std::map<CacheKey, CacheList::iterator>::iterator found = cache.find(key);
+    if (found != cache.end()) {
+        cache_list.splice(cache_list.begin(), cache_list, found->second);
+        return found->second->second;
+    }
+
+    std::shared_ptr<const GaussianKernel> kernel = std::make_shared<const GaussianKernel>(kernelSize, sigma);
+    cache_list.push_front(std::make_pair(key, kernel));
+    cache[key] = cache_list.begin();
+    if (cache_list.size() > static_cast<size_t>(CACHE_CAPACITY)) {
+        cache.erase(cache_list.back().first);
+        cache_list.pop_back();
+    }
+    return kernel;
+}
+
+void GaussianKernel::clear_cache() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+    cache_list.clear();
+}
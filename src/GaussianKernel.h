@@ -0,0 +1,60 @@
+#ifndef GAUSSIAN_KERNEL_H
+#define GAUSSIAN_KERNEL_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Precomputed Gaussian weights for one (kernelSize, sigma) pair.
+// Kernels are immutable once built and shared through a process-wide cache, so
+// every filter call with the same parameters reuses the same exp() results. The cache keeps
+// the CACHE_CAPACITY most recently used kernels and drops the least recently used one beyond that.
+class GaussianKernel {
+private:
+    int size;
+    int radius;
+    double sigma;
+    std::vector<double> weights;        // Normalised 1D weights, index t + radius for offset t
+    std::vector<int16_t> fixed_weights; // The same in units of 2^-PixelKernels::FIXED_WEIGHT_BITS
+
+    mutable std::once_flag weights_2d_built;
+    mutable std::vector<double> weights_2d;     // exp(-(i^2 + j^2) / 2s^2) / (2 pi s^2), row-major
+    mutable double weight_sum_2d;
+
+    void build_weights_2d() const;
+
+public:
+    // Most kernels the cache holds at once
+    static const int CACHE_CAPACITY = 64;
+
+    // Constructor: evaluates the 1D kernel; the 2D table is only built on first use
+    GaussianKernel(int kernelSize, double sigma);
+
+    // Returns the shared kernel for these parameters, building it if it is not cached.
+    // Safe to call from several threads at once.
+    static std::shared_ptr<const GaussianKernel> get(int kernelSize, double sigma);
+
+    // Drops every cached kernel (kernels still in use stay alive until released).
+    static void clear_cache();
+
+    int get_size() const { return size; }
+    int get_radius() const { return radius; }
+    double get_sigma() const { return sigma; }
+
+    // Normalised 1D weights (they sum to 1), kernelSize entries
+    const std::vector<double>& get_weights() const { return weights; }
+
+    // 1D weights in fixed point for PixelKernels::convolve_row_fixed/convolve_column_fixed: each
+    // weight rounded to the nearest multiple of 2^-FIXED_WEIGHT_BITS, with the rounding residue
+    // moved to the centre tap so they sum to exactly 1 << FIXED_WEIGHT_BITS
+    const std::vector<int16_t>& get_fixed_weights() const { return fixed_weights; }
+
+    // Unnormalised 2D weights, kernelSize x kernelSize row-major, as the direct convolution uses them
+    const std::vector<double>& get_weights_2d() const;
+
+    // Sum of get_weights_2d(), accumulated in row-major order
+    double get_weight_sum_2d() const;
+};
+
+#endif // GAUSSIAN_KERNEL_H
@@ -1,6 +1,14 @@
 #include "GrayscaleImage.h"
+#include "ContentHash.h"
+#include "PixelKernels.h"
 #include <iostream>
+#include <climits>
 #include <cstring>  // For memcpy
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <vector>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -8,109 +16,271 @@
 #include <stdexcept>
 
 
-// Constructor: load from a file
-GrayscaleImage::GrayscaleImage(const char* filename) {
+// Allocates size bytes aligned to GrayscaleImage::ALIGNMENT. The pointer returned
+// by malloc is stored right in front of the aligned block so it can be freed later.
+static void* aligned_allocate(size_t size) {
+    void* raw = std::malloc(size + GrayscaleImage::ALIGNMENT + sizeof(void*));
+    if (raw == nullptr) {
+        throw std::bad_alloc();
+    }
+    uintptr_t base = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+    uintptr_t aligned = (base + GrayscaleImage::ALIGNMENT - 1) & ~static_cast<uintptr_t>(GrayscaleImage::ALIGNMENT - 1);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+// Frees a block returned by aligned_allocate.
+static void aligned_free(void* block) {
+    if (block != nullptr) {
+        std::free(reinterpret_cast<void**>(block)[-1]);
+    }
+}
+
+// Allocate one contiguous buffer for all rows plus the row pointer table into it
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::allocate(int w, int h) {
+    // Round every row up to a whole number of aligned blocks so each row starts aligned.
+    const int pixels_per_block = ALIGNMENT / static_cast<int>(sizeof(Pixel));
+    int row_stride = ((w + pixels_per_block - 1) / pixels_per_block) * pixels_per_block;
+    Pixel* buffer = static_cast<Pixel*>(aligned_allocate(sizeof(Pixel) * row_stride * h));
+    adopt(buffer, w, h, row_stride, aligned_free);
+}
+
+// Take ownership of a buffer laid out as h rows of row_stride pixels
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::adopt(Pixel* buffer, int w, int h, int row_stride, void (*deleter)(void*)) {
+    this->width = w;
+    this->height = h;
+    this->stride = row_stride;
+    this->set_pixel_amount();
+    this->pixels = buffer;
+    this->pixel_deleter = deleter;
+    this->content_hash = 0;
+    this->hash_valid = false;
 
+    try {
+        this->data = new Pixel*[height];
+    } catch (...) {
+        deleter(buffer);
+        throw;
+    }
+    for (int i = 0; i < height; ++i)
+        data[i] = pixels + static_cast<long>(i) * stride;
+}
+
+// Copy pixel values row by row; the two images may use different strides
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::copy_pixels_from(const BasicGrayscaleImage& other) {
+    if (stride == other.stride) {
+        std::memcpy(pixels, other.pixels, sizeof(Pixel) * stride * height);
+    } else {
+        for (int i = 0; i < height; ++i) {
+            std::memcpy(get_row(i), other.get_row(i), sizeof(Pixel) * width);
+        }
+    }
+}
+
+// Free the contiguous buffer and the row pointer table
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::release() {
+    if (pixels != nullptr) {
+        pixel_deleter(pixels);
+    }
+    delete[] data;
+    pixels = nullptr;
+    data = nullptr;
+}
+
+// Load an 8-bit image
+template <>
+void BasicGrayscaleImage<uint8_t>::load(const char* filename) {
     // Image loading code using stbi
-    int channels;
-    unsigned char* image = stbi_load(filename, &width, &height, &channels, STBI_grey);
+    int channels, w, h;
+    unsigned char* image = stbi_load(filename, &w, &h, &channels, STBI_grey);
 
     if (image == nullptr) {
         std::cerr << "Error: Could not load image " << filename << std::endl;
         exit(1);
     }
 
+    // stbi already returns tightly packed 8-bit rows, which is our layout with
+    // stride == width, so keep its buffer and free it through stbi on release.
+    adopt(image, w, h, w, stbi_image_free);
+}
 
-    // Dynamically allocate memory for a 2D matrix based on the given dimensions.
-    // Fill the matrix with pixel values from the image
-    this->data = new int*[height];
-    for(int i=0;i<height;i++)
-        data[i] = new int[width];
+// Load a 16-bit image
+template <>
+void BasicGrayscaleImage<uint16_t>::load(const char* filename) {
+    int channels, w, h;
+    stbi_us* image = stbi_load_16(filename, &w, &h, &channels, STBI_grey);
 
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            this->data[i][j] = image[i*width + j];
-        }
+    if (image == nullptr) {
+        std::cerr << "Error: Could not load image " << filename << std::endl;
+        exit(1);
     }
 
-    this->set_pixel_amount();
+    // Tightly packed 16-bit rows in host byte order, adopted like the 8-bit ones
+    adopt(image, w, h, w, stbi_image_free);
+}
 
-    // Free the dynamically allocated memory of stbi image
+// Load a float image on the 8-bit scale
+template <>
+void BasicGrayscaleImage<float>::load(const char* filename) {
+    int channels, w, h;
+    if (stbi_is_16_bit(filename)) {
+        stbi_us* image = stbi_load_16(filename, &w, &h, &channels, STBI_grey);
+        if (image == nullptr) {
+            std::cerr << "Error: Could not load image " << filename << std::endl;
+            exit(1);
+        }
+        allocate(w, h);
+        for (int i = 0; i < h; ++i) {
+            for (int j = 0; j < w; ++j) {
+                get_row(i)[j] = image[static_cast<size_t>(i) * w + j] * (255.0f / 65535.0f);
+            }
+        }
+        stbi_image_free(image);
+        return;
+    }
+
+    unsigned char* image = stbi_load(filename, &w, &h, &channels, STBI_grey);
+    if (image == nullptr) {
+        std::cerr << "Error: Could not load image " << filename << std::endl;
+        exit(1);
+    }
+    allocate(w, h);
+    for (int i = 0; i < h; ++i) {
+        for (int j = 0; j < w; ++j) {
+            get_row(i)[j] = image[static_cast<size_t>(i) * w + j];
+        }
+    }
     stbi_image_free(image);
 }
 
+// Constructor: load from a file
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>::BasicGrayscaleImage(const char* filename) {
+    load(filename);
+    get_hash();
+}
+
 // Constructor: initialize from a pre-existing data matrix
-GrayscaleImage::GrayscaleImage(int** inputData, int h, int w) {
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>::BasicGrayscaleImage(int** inputData, int h, int w) {
     // Initialize the image with a pre-existing data matrix by copying the values.
-    // Don't forget to dynamically allocate memory for the matrix.
-    this->width = w;
-    this->height = h;
-    this->set_pixel_amount();
-
-    this->data = new int*[height];
-    for(int i=0;i<height;i++)
-        data[i] = new int[width];
-
+    allocate(w, h);
     for (int i = 0; i < height; ++i) {
         for (int j = 0; j < width; ++j) {
-            this->data[i][j] = inputData[i][j];
+            set_pixel(i, j, inputData[i][j]);
         }
     }
 }
 
 // Constructor to create a blank image of given width and height
-GrayscaleImage::GrayscaleImage(int w, int h) : width(w), height(h) {
-    // Just dynamically allocate the memory for the new matrix.
-    this->data = new int*[height];
-    for(int i=0;i<height;i++)
-        data[i] = new int[width];
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>::BasicGrayscaleImage(int w, int h) {
+    // Just allocate the memory for the new buffer.
+    allocate(w, h);
+}
 
-    this->set_pixel_amount();
+// Constructor: copy a view (possibly a sub-region of another image)
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>::BasicGrayscaleImage(const ConstView& view) {
+    allocate(view.get_width(), view.get_height());
+    for (int i = 0; i < height; ++i) {
+        std::memcpy(get_row(i), view.get_row(i), sizeof(Pixel) * width);
+    }
 }
 
 // Copy constructor
-GrayscaleImage::GrayscaleImage(const GrayscaleImage& other) {
-    // Copy constructor: dynamically allocate memory and
-    // copy pixel values from another image.
-    this->width = other.width;
-    this->height = other.height;
-    this->set_pixel_amount();
-
-    this->data = new int*[height];
-    for(int i=0;i<height;i++)
-        data[i] = new int[width];
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>::BasicGrayscaleImage(const BasicGrayscaleImage& other) {
+    // Copy constructor: allocate an aligned buffer and copy the pixels over.
+    allocate(other.width, other.height);
+    copy_pixels_from(other);
+    content_hash = other.content_hash;
+    hash_valid = other.hash_valid;
+}
 
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            this->data[i][j] = other.data[i][j];
+// Copy assignment
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>& BasicGrayscaleImage<Pixel>::operator=(const BasicGrayscaleImage& other) {
+    if (this != &other) {
+        if (width != other.width || height != other.height) {
+            release();
+            allocate(other.width, other.height);
         }
+        copy_pixels_from(other);
+        content_hash = other.content_hash;
+        hash_valid = other.hash_valid;
     }
+    return *this;
 }
 
-// Destructor
-GrayscaleImage::~GrayscaleImage() {
-    // Destructor: deallocate memory for the matrix.
-    if (this->data != nullptr){
-        for (int i = 0; i < this->height; ++i) {
-            if (this->data[i] != nullptr){
-                delete[] data[i];
-            }
-        }
-        delete[] data;
+// Move constructor
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>::BasicGrayscaleImage(BasicGrayscaleImage&& other) noexcept
+        : pixels(other.pixels), data(other.data), width(other.width), height(other.height),
+          stride(other.stride), pixel_amount(other.pixel_amount), pixel_deleter(other.pixel_deleter),
+          content_hash(other.content_hash), hash_valid(other.hash_valid) {
+    // Leave the source as a valid empty image so its destructor frees nothing.
+    other.pixels = nullptr;
+    other.data = nullptr;
+    other.width = other.height = other.stride = other.pixel_amount = 0;
+    other.hash_valid = false;
+}
+
+// Move assignment
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>& BasicGrayscaleImage<Pixel>::operator=(BasicGrayscaleImage&& other) noexcept {
+    if (this != &other) {
+        release();
+        pixels = other.pixels;
+        data = other.data;
+        width = other.width;
+        height = other.height;
+        stride = other.stride;
+        pixel_amount = other.pixel_amount;
+        pixel_deleter = other.pixel_deleter;
+        content_hash = other.content_hash;
+        hash_valid = other.hash_valid;
+
+        other.pixels = nullptr;
+        other.data = nullptr;
+        other.width = other.height = other.stride = other.pixel_amount = 0;
+        other.hash_valid = false;
     }
+    return *this;
+}
+
+// Destructor
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>::~BasicGrayscaleImage() {
+    // Destructor: deallocate the pixel buffer and the row table.
+    release();
 }
 
 // Equality operator
-bool GrayscaleImage::operator==(const GrayscaleImage& other) const {
+template <typename Pixel>
+bool BasicGrayscaleImage<Pixel>::operator==(const BasicGrayscaleImage& other) const {
     // Check if two images have the same dimensions and pixel values.
     // If they do, return true.
 
     if (this->width == other.width && this->height == other.height){
+        // Different hashes can only come from different pixels.
+        if (this->hash_valid && other.hash_valid && this->content_hash != other.content_hash) {
+            return false;
+        }
+        // Tightly packed buffers are compared in one go, others row by row, as bytes.
+        const int row_bytes = static_cast<int>(sizeof(Pixel)) * this->width;
+        if (this->stride == this->width && other.stride == other.width) {
+            return PixelKernels::equal(reinterpret_cast<const uint8_t*>(this->pixels),
+                                       reinterpret_cast<const uint8_t*>(other.pixels), row_bytes * this->height);
+        }
         for (int i = 0; i < this->height; ++i) {
-            for (int j = 0; j < this->width; ++j) {
-                if (this->data[i][j] != other.data[i][j]){
-                    return false;
-                }
+            if (!PixelKernels::equal(reinterpret_cast<const uint8_t*>(this->get_row(i)),
+                                     reinterpret_cast<const uint8_t*>(other.get_row(i)), row_bytes)){
+                return false;
             }
         }
         return true;
@@ -118,77 +288,266 @@ bool GrayscaleImage::operator==(const GrayscaleImage& other) const {
     return false;
 }
 
-// Addition operator
-GrayscaleImage GrayscaleImage::operator+(const GrayscaleImage& other) const {
-    // Create a new image for the result
-    GrayscaleImage result(width, height);
-    
-    // Add two images' pixel values and return a new image, clamping the results.
-    int pixel_value;
-    for (int i = 0; i < this->height; ++i) {
-        for (int j = 0; j < this->width; ++j) {
-            pixel_value = (this->data[i][j] + other.data[i][j]);
-            if (pixel_value < 0){
-                result.data[i][j] = 0;
-            } else if (pixel_value > 255){
-                result.data[i][j] = 255;
-            } else {
-                result.data[i][j] = pixel_value;
-            }
-        }
+// Throws unless the three views of a binary operation have the same size
+template <typename Pixel>
+static void check_same_size(const BasicImageView<const Pixel>& a, const BasicImageView<const Pixel>& b,
+                            const BasicImageView<Pixel>& out) {
+    if (!a.same_size(b) || !a.same_size(out)) {
+        throw std::invalid_argument("Images must have the same dimensions.");
     }
-    return result;
-}
-
-// Subtraction operator
-GrayscaleImage GrayscaleImage::operator-(const GrayscaleImage& other) const {
-    // Create a new image for the result
-    GrayscaleImage result(width, height);
-    
-    // Subtract pixel values of two images and return a new image, clamping the results.
-    int pixel_value;
-    for (int i = 0; i < this->height; ++i) {
-        for (int j = 0; j < this->width; ++j) {
-            pixel_value = (this->data[i][j] - other.data[i][j]);
-            if (pixel_value < 0){
-                result.data[i][j] = 0;
-            } else if (pixel_value > 255){
-                result.data[i][j] = 255;
-            } else {
-                result.data[i][j] = pixel_value;
-            }
-        }
+}
+
+// Throws unless a unary operation's output has the size of its input
+template <typename Pixel>
+static void check_same_size(const BasicImageView<const Pixel>& a, const BasicImageView<Pixel>& out) {
+    if (!a.same_size(out)) {
+        throw std::invalid_argument("Images must have the same dimensions.");
+    }
+}
+
+// Applies a binary row operation (see ImageExpression.h) to every row of a and b
+template <typename Pixel, typename Operation>
+static void apply_rows(const BasicImageView<const Pixel>& a, const BasicImageView<const Pixel>& b,
+                       const BasicImageView<Pixel>& out, const Operation& operation) {
+    check_same_size(a, b, out);
+    for (int i = 0; i < a.get_height(); ++i) {
+        operation.apply(a.get_row(i), b.get_row(i), out.get_row(i), a.get_width());
+    }
+}
+
+// Applies a scalar row operation to every row of a
+template <typename Pixel, typename Operation>
+static void apply_rows(const BasicImageView<const Pixel>& a, const BasicImageView<Pixel>& out,
+                       const Operation& operation) {
+    check_same_size(a, out);
+    for (int i = 0; i < a.get_height(); ++i) {
+        operation.apply(a.get_row(i), out.get_row(i), a.get_width());
     }
-    return result;
+}
+
+// Saturating addition of two views, with packed saturating adds for 8-bit pixels
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::add(const ConstView& a, const ConstView& b, const View& out) {
+    apply_rows(a, b, out, SaturatingAdd());
+}
+
+// Saturating subtraction of two views
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::subtract(const ConstView& a, const ConstView& b, const View& out) {
+    apply_rows(a, b, out, SaturatingSubtract());
+}
+
+// Saturating addition of a constant; a negative value is subtracted instead
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::add(const ConstView& a, int value, const View& out) {
+    SaturatingAddScalar operation = { value };
+    apply_rows(a, out, operation);
+}
+
+// Saturating subtraction of a constant; a negative value is added instead
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::subtract(const ConstView& a, int value, const View& out) {
+    SaturatingAddScalar operation = { value == INT_MIN ? INT_MAX : -value };
+    apply_rows(a, out, operation);
+}
+
+// Multiplication by a constant
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::multiply(const ConstView& a, double factor, const View& out) {
+    Scale operation = { factor };
+    apply_rows(a, out, operation);
+}
+
+// Absolute difference of two views
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::absolute_difference(const ConstView& a, const ConstView& b, const View& out) {
+    apply_rows(a, b, out, AbsoluteDifference());
+}
+
+// Weighted blend of two views
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::blend(const ConstView& a, const ConstView& b, double alpha, const View& out) {
+    Blend operation = { alpha };
+    apply_rows(a, b, out, operation);
+}
+
+// In-place addition
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>& BasicGrayscaleImage<Pixel>::operator+=(const ConstView& other) {
+    add(view(), other, view());
+    return *this;
+}
+
+// In-place subtraction
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>& BasicGrayscaleImage<Pixel>::operator-=(const ConstView& other) {
+    subtract(view(), other, view());
+    return *this;
+}
+
+// In-place addition of a constant
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>& BasicGrayscaleImage<Pixel>::operator+=(int value) {
+    add(view(), value, view());
+    return *this;
+}
+
+// In-place subtraction of a constant
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>& BasicGrayscaleImage<Pixel>::operator-=(int value) {
+    subtract(view(), value, view());
+    return *this;
+}
+
+// In-place multiplication by a constant
+template <typename Pixel>
+BasicGrayscaleImage<Pixel>& BasicGrayscaleImage<Pixel>::operator*=(double factor) {
+    multiply(view(), factor, view());
+    return *this;
+}
+
+// Content hash, cached until the pixels may have been written
+template <typename Pixel>
+uint64_t BasicGrayscaleImage<Pixel>::get_hash() const {
+    if (!hash_valid) {
+        content_hash = ContentHash::of(view());
+        hash_valid = true;
+    }
+    return content_hash;
 }
 
 // Get a specific pixel value
-int GrayscaleImage::get_pixel(int row, int col) const {
-    return data[row][col];
+template <typename Pixel>
+typename BasicGrayscaleImage<Pixel>::value_type BasicGrayscaleImage<Pixel>::get_pixel(int row, int col) const {
+    return get_row(row)[col];
 }
 
 // Set a specific pixel value
-void GrayscaleImage::set_pixel(int row, int col, int value) {
-    data[row][col] = value;
+template <typename Pixel>
+void BasicGrayscaleImage<Pixel>::set_pixel(int row, int col, value_type value) {
+    get_row(row)[col] = PixelTraits<Pixel>::clamp(value);
 }
 
-// Function to save the image to a PNG file
-void GrayscaleImage::save_to_file(const char* filename) const {
-    // Create a buffer to hold the image data in the format stb_image_write expects
-    unsigned char* imageBuffer = new unsigned char[width * height];
+// Lookup table of the PNG CRC-32, one entry per byte value
+static std::vector<uint32_t> build_crc_table() {
+    std::vector<uint32_t> table(256);
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[n] = c;
+    }
+    return table;
+}
+
+// CRC-32 as used by PNG chunks, continuing from crc (0 for a new checksum)
+static uint32_t png_crc32(uint32_t crc, const unsigned char* bytes, size_t length) {
+    static const std::vector<uint32_t> table = build_crc_table();
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
 
-    // Fill the buffer with pixel data (convert int to unsigned char)
+// Writes one PNG chunk: length, type, data and CRC of type and data
+static bool write_png_chunk(FILE* file, const char* type, const unsigned char* bytes, size_t length) {
+    unsigned char header[8] = {
+        static_cast<unsigned char>(length >> 24), static_cast<unsigned char>(length >> 16),
+        static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(length),
+        static_cast<unsigned char>(type[0]), static_cast<unsigned char>(type[1]),
+        static_cast<unsigned char>(type[2]), static_cast<unsigned char>(type[3])
+    };
+    uint32_t crc = png_crc32(png_crc32(0, header + 4, 4), bytes, length);
+    unsigned char footer[4] = {
+        static_cast<unsigned char>(crc >> 24), static_cast<unsigned char>(crc >> 16),
+        static_cast<unsigned char>(crc >> 8), static_cast<unsigned char>(crc)
+    };
+    return std::fwrite(header, 1, 8, file) == 8 && (length == 0 || std::fwrite(bytes, 1, length, file) == length) &&
+           std::fwrite(footer, 1, 4, file) == 4;
+}
+
+// stb_image_write only writes 8-bit PNGs, so 16-bit grayscale ones are put together here around
+// stb's zlib compressor. Samples are stored big-endian, every row with the Sub filter.
+static bool write_png16(const char* filename, const uint16_t* pixels, int width, int height, int stride) {
+    const size_t row_bytes = 2 * static_cast<size_t>(width);
+    std::vector<unsigned char> filtered((row_bytes + 1) * height);
     for (int i = 0; i < height; ++i) {
+        const uint16_t* row = pixels + static_cast<long>(i) * stride;
+        unsigned char* out = &filtered[(row_bytes + 1) * i];
+        out[0] = 1;     // Sub: each byte minus the same byte of the previous sample
+        uint16_t previous = 0;
         for (int j = 0; j < width; ++j) {
-            imageBuffer[i * width + j] = static_cast<unsigned char>(data[i][j]);
+            out[1 + 2 * j] = static_cast<unsigned char>((row[j] >> 8) - (previous >> 8));
+            out[2 + 2 * j] = static_cast<unsigned char>((row[j] & 0xFF) - (previous & 0xFF));
+            previous = row[j];
         }
     }
+    int compressed_length = 0;
+    unsigned char* compressed = stbi_zlib_compress(filtered.data(), static_cast<int>(filtered.size()),
+                                                   &compressed_length, stbi_write_png_compression_level);
+    if (compressed == nullptr) {
+        return false;
+    }
+
+    const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    const unsigned char header[13] = {
+        static_cast<unsigned char>(width >> 24), static_cast<unsigned char>(width >> 16),
+        static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width),
+        static_cast<unsigned char>(height >> 24), static_cast<unsigned char>(height >> 16),
+        static_cast<unsigned char>(height >> 8), static_cast<unsigned char>(height),
+        16, 0, 0, 0, 0      // Bit depth 16, grayscale, deflate, adaptive filtering, no interlace
+    };
+    FILE* file = std::fopen(filename, "wb");
+    bool written = file != nullptr && std::fwrite(signature, 1, 8, file) == 8 &&
+                   write_png_chunk(file, "IHDR", header, sizeof(header)) &&
+                   write_png_chunk(file, "IDAT", compressed, compressed_length) &&
+                   write_png_chunk(file, "IEND", nullptr, 0);
+    if (file != nullptr && std::fclose(file) != 0) {
+        written = false;
+    }
+    STBIW_FREE(compressed);
+    return written;
+}
 
-    // Write the buffer to a PNG file
-    if (!stbi_write_png(filename, width, height, 1, imageBuffer, width)) {
+// Function to save the image to a PNG file
+template <>
+void BasicGrayscaleImage<uint8_t>::save_to_file(const char* filename) const {
+    // The pixel buffer already is 8-bit rows at a fixed stride, which is exactly
+    // what stb_image_write expects, so hand it over without a staging copy.
+    if (!stbi_write_png(filename, width, height, 1, pixels, stride)) {
         std::cerr << "Error: Could not save image to file " << filename << std::endl;
     }
+}
 
-    // Clean up the allocated buffer
-    delete[] imageBuffer;
+template <>
+void BasicGrayscaleImage<uint16_t>::save_to_file(const char* filename) const {
+    if (!write_png16(filename, pixels, width, height, stride)) {
+        std::cerr << "Error: Could not save image to file " << filename << std::endl;
+    }
 }
+
+template <>
+void BasicGrayscaleImage<float>::save_to_file(const char* filename) const {
+    // Quantised once, here, rather than after every intermediate step
+    std::vector<uint8_t> quantised(static_cast<size_t>(width) * height);
+    for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+            quantised[static_cast<size_t>(i) * width + j] = PixelTraits<uint8_t>::from_double_rounded(get_row(i)[j]);
+        }
+    }
+    if (!stbi_write_png(filename, width, height, 1, quantised.empty() ? nullptr : &quantised[0], width)) {
+        std::cerr << "Error: Could not save image to file " << filename << std::endl;
+    }
+}
+
+// Whether a file holds 16 bits per sample
+template <typename Pixel>
+bool BasicGrayscaleImage<Pixel>::is_16_bit_file(const char* filename) {
+    return stbi_is_16_bit(filename) != 0;
+}
+
+template class BasicGrayscaleImage<uint8_t>;
+template class BasicGrayscaleImage<uint16_t>;
+template class BasicGrayscaleImage<float>;
@@ -1,48 +1,217 @@
 #ifndef GRAYSCALE_IMAGE_H
 #define GRAYSCALE_IMAGE_H
 
-class GrayscaleImage {
+#include <cstdint>
+
+#include "ImageExpression.h"
+#include "ImageView.h"
+#include "PixelTraits.h"
+
+// Grayscale image with pixels of type Pixel: uint8_t, uint16_t or float (see PixelTraits).
+// The member functions are compiled once for each of the three in GrayscaleImage.cpp; use
+// them through the GrayscaleImage, GrayscaleImage16 and GrayscaleImageF typedefs below.
+template <typename Pixel>
+class BasicGrayscaleImage {
+public:
+    typedef Pixel pixel_type;
+    typedef typename PixelTraits<Pixel>::value_type value_type;
+    typedef BasicImageView<Pixel> View;
+    typedef BasicImageView<const Pixel> ConstView;
+
 private:
-    int** data;
+    Pixel* pixels;      // Single contiguous buffer of pixels holding every row
+    Pixel** data;       // Row pointers into pixels, kept for get_data() callers
     int width, height;
+    int stride;     // Distance between the starts of two rows, in pixels
     int pixel_amount;
+    void (*pixel_deleter)(void*);   // Frees pixels the way it was allocated
+    mutable uint64_t content_hash;  // ContentHash of the pixels, valid while hash_valid is set
+    mutable bool hash_valid;
+
+    // Allocates an aligned pixel buffer and the row pointer table for a w x h image.
+    void allocate(int w, int h);
+
+    // Takes ownership of an existing pixel buffer; deleter is called on it on release.
+    void adopt(Pixel* buffer, int w, int h, int row_stride, void (*deleter)(void*));
+
+    // Copies the visible pixels of other into this image's (already allocated) buffer.
+    void copy_pixels_from(const BasicGrayscaleImage& other);
+
+    // Reads a PNG (or any format stb_image knows) into this unconstructed image
+    void load(const char* filename);
+
+    // Frees the pixel buffer and the row pointer table.
+    void release();
+
+    // Called by every accessor that hands out writable pixels
+    void invalidate_hash() { hash_valid = false; }
 
 public:
-    // Constructor: loads an image from a file
-    GrayscaleImage(const char* filename);
+    // Every row of a buffer allocated by the image starts on a boundary of this many bytes.
+    static const int ALIGNMENT = 64;
+
+    // Constructor: loads an image from a file.
+    // 8-bit images take over stb's decode buffer as is (stride == width, no extra copy);
+    // 16-bit images do the same with stbi_load_16, which widens 8-bit files (v * 257).
+    // Float images keep 8-bit values as they are and scale 16-bit files to 0-255.
+    // The content hash is computed right away.
+    BasicGrayscaleImage(const char* filename);
 
     // Constructor: initializes from a 2D data matrix
-    GrayscaleImage(int** inputData, int h, int w);
+    BasicGrayscaleImage(int** inputData, int h, int w);
 
     // Constructor to create a blank image of given width and height
-    GrayscaleImage(int w, int h);
+    BasicGrayscaleImage(int w, int h);
+
+    // Constructor: copies the pixels seen through a view into a new image
+    explicit BasicGrayscaleImage(const ConstView& view);
 
     // Copy constructor
-    GrayscaleImage(const GrayscaleImage& other);
+    BasicGrayscaleImage(const BasicGrayscaleImage& other);
+
+    // Copy assignment
+    BasicGrayscaleImage& operator=(const BasicGrayscaleImage& other);
+
+    // Move constructor: takes over the pixel buffer, leaving other empty (0x0)
+    BasicGrayscaleImage(BasicGrayscaleImage&& other) noexcept;
+
+    // Move assignment
+    BasicGrayscaleImage& operator=(BasicGrayscaleImage&& other) noexcept;
+
+    // Constructor: evaluates an arithmetic expression such as a + b - c in a single pass
+    template <typename Expression,
+              typename std::enable_if<is_image_expression_of<Expression, Pixel>::value, int>::type = 0>
+    BasicGrayscaleImage(const Expression& expression) {
+        allocate(expression.get_width(), expression.get_height());
+        expression.evaluate_into(view());
+    }
+
+    // Assignment from an arithmetic expression. An image of the same size is overwritten in
+    // place (it may appear in the expression itself, as in a = a + b); otherwise a new buffer
+    // is allocated.
+    template <typename Expression,
+              typename std::enable_if<is_image_expression_of<Expression, Pixel>::value, int>::type = 0>
+    BasicGrayscaleImage& operator=(const Expression& expression) {
+        if (width != expression.get_width() || height != expression.get_height()) {
+            return *this = BasicGrayscaleImage(expression);
+        }
+        expression.evaluate_into(view());
+        return *this;
+    }
 
     // Destructor
-    ~GrayscaleImage();
+    ~BasicGrayscaleImage();
 
     // Operator overloads
-    bool operator==(const GrayscaleImage& other) const;
-    GrayscaleImage operator+(const GrayscaleImage& other) const;
-    GrayscaleImage operator-(const GrayscaleImage& other) const;
+    // + and - (declared in ImageExpression.h) build a lazy expression; it is
+    // evaluated when it is used to construct or assign a GrayscaleImage.
+    // == returns false at once when both images have a cached hash and the hashes
+    // differ; otherwise it compares the pixels with the vector equality kernel.
+    // Float images compare their pixels bit for bit.
+    bool operator==(const BasicGrayscaleImage& other) const;
+
+    // In-place saturating arithmetic; nothing is allocated unless the right-hand side is
+    // an expression, which needs one scratch row per operation.
+    BasicGrayscaleImage& operator+=(const ConstView& other);
+    BasicGrayscaleImage& operator-=(const ConstView& other);
+    BasicGrayscaleImage& operator+=(int value);
+    BasicGrayscaleImage& operator-=(int value);
+    BasicGrayscaleImage& operator*=(double factor);
+
+    template <typename Expression,
+              typename std::enable_if<is_image_expression_of<Expression, Pixel>::value, int>::type = 0>
+    BasicGrayscaleImage& operator+=(const Expression& expression) {
+        return *this = *this + expression;
+    }
+
+    template <typename Expression,
+              typename std::enable_if<is_image_expression_of<Expression, Pixel>::value, int>::type = 0>
+    BasicGrayscaleImage& operator-=(const Expression& expression) {
+        return *this = *this - expression;
+    }
+
+    // Saturating a + b and a - b written into out, row by row; all three views
+    // must have the same size and out may alias a or b. Float pixels do not saturate.
+    static void add(const ConstView& a, const ConstView& b, const View& out);
+    static void subtract(const ConstView& a, const ConstView& b, const View& out);
+
+    // Saturating a + value and a - value written into out (same size as a, may alias it);
+    // value may be negative.
+    static void add(const ConstView& a, int value, const View& out);
+    static void subtract(const ConstView& a, int value, const View& out);
+
+    // factor * a, rounded half up and clamped to the pixel range, written into out (may alias a)
+    static void multiply(const ConstView& a, double factor, const View& out);
+
+    // |a - b| written into out; same size rules as add
+    static void absolute_difference(const ConstView& a, const ConstView& b, const View& out);
+
+    // alpha * a + (1 - alpha) * b, rounded half up and clamped to the pixel range, written into
+    // out; same size rules as add. 8-bit pixels are scaled and blended in single precision,
+    // the others in double precision.
+    static void blend(const ConstView& a, const ConstView& b, double alpha, const View& out);
+
+    // 64-bit content hash of the pixels (see ContentHash), computed on first use and cached.
+    // Every non-const accessor below that can hand out writable pixels drops the cached
+    // value; pixels must not be written through a pointer or view obtained before the last
+    // get_hash() call.
+    uint64_t get_hash() const;
+
+    // Views over the whole image, or over the h x w region whose top-left corner is (row, col).
+    View view() { invalidate_hash(); return View(pixels, width, height, stride); }
+    ConstView view() const { return ConstView(pixels, width, height, stride); }
+    View region(int row, int col, int h, int w) { return view().region(row, col, h, w); }
+    ConstView region(int row, int col, int h, int w) const { return view().region(row, col, h, w); }
+
+    // Lets an image be passed wherever a read-only view is expected.
+    operator ConstView() const { return view(); }
 
     // Method to get image dimensions
     int get_width() const { return width; }
     int get_height() const { return height; }
 
+    // Row stride of the contiguous buffer, in pixels (>= width)
+    int get_stride() const { return stride; }
+
     // Get a specific pixel value
-    int get_pixel(int row, int col) const;
+    value_type get_pixel(int row, int col) const;
 
-    // Set a specific pixel value
-    void set_pixel(int row, int col, int value);
+    // Set a specific pixel value, clamped to the pixel range ([0-255] for 8-bit pixels)
+    void set_pixel(int row, int col, value_type value);
 
-    // Function to write the image data back to a PNG file
+    // Function to write the image data back to a PNG file.
+    // 16-bit images are written as 16-bit PNGs; float images are rounded half up and
+    // clamped to an 8-bit PNG.
     void save_to_file(const char* filename) const;
 
+    // True if the file is a 16-bit image (worth loading into a GrayscaleImage16)
+    static bool is_16_bit_file(const char* filename);
+
+    // Pointer to the first pixel of the given row in the contiguous buffer.
+    Pixel* get_row(int row) {
+        invalidate_hash();
+        return pixels + static_cast<long>(row) * stride;
+    }
+    const Pixel* get_row(int row) const {
+        return pixels + static_cast<long>(row) * stride;
+    }
+
+    // Pointer to the start of the contiguous buffer (row r begins at r * stride).
+    Pixel* get_pixels() {
+        invalidate_hash();
+        return pixels;
+    }
+    const Pixel* get_pixels() const {
+        return pixels;
+    }
+
     // Getter function for data.
-    int** get_data() const {
+    // Row pointer view over the contiguous buffer; get_data()[i] == get_row(i).
+    Pixel** get_data() {
+        invalidate_hash();
+        return data;
+    }
+    const Pixel* const* get_data() const {
         return data;
     }
 
@@ -57,4 +226,8 @@ public:
     }
 };
 
+typedef BasicGrayscaleImage<uint8_t> GrayscaleImage;
+typedef BasicGrayscaleImage<uint16_t> GrayscaleImage16;
+typedef BasicGrayscaleImage<float> GrayscaleImageF;
+
 #endif // GRAYSCALE_IMAGE_H
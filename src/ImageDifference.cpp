@@ -0,0 +1,140 @@
+#include "ImageDifference.h"
+#include "PixelKernels.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Below this many pixels a chunk of rows is not worth handing to another thread
+static const long long MIN_CHUNK_PIXELS = 1 << 16;
+
+// One pair of rows: the vector kernel for 8-bit rows, the same statistics for 16-bit ones
+static void difference_row(const uint8_t* a, const uint8_t* b, int n, PixelKernels::RowDifference& stats) {
+    PixelKernels::difference_row(a, b, n, stats);
+}
+
+static void difference_row(const uint16_t* a, const uint16_t* b, int n, PixelKernels::RowDifference& stats) {
+    stats.squared_sum = 0;
+    stats.max_difference = 0;
+    stats.differing = 0;
+    stats.first = -1;
+    stats.last = -1;
+    for (int i = 0; i < n; ++i) {
+        const int difference = std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+        if (difference != 0) {
+            stats.squared_sum += static_cast<uint64_t>(difference) * difference;
+            stats.max_difference = std::max(stats.max_difference, difference);
+            if (stats.first < 0) {
+                stats.first = i;
+            }
+            stats.last = i;
+            ++stats.differing;
+        }
+    }
+}
+
+ImageDifference::ImageDifference(int width, int height, int peak)
+    : width(width), height(height), peak(peak), squared_sum(0), max_difference(0), differing_pixels(0),
+      top(-1), left(-1), bottom(-1), right(-1) {}
+
+template <typename Pixel>
+void ImageDifference::add_rows(const BasicImageView<const Pixel>& a, const BasicImageView<const Pixel>& b,
+                               int first, int last) {
+    PixelKernels::RowDifference row;
+    for (int i = first; i < last; ++i) {
+        difference_row(a.get_row(i), b.get_row(i), width, row);
+        squared_sum += row.squared_sum;
+        max_difference = std::max(max_difference, row.max_difference);
+        if (row.differing > 0) {
+            differing_pixels += row.differing;
+            if (top < 0) {
+                top = i;
+                left = row.first;
+                right = row.last;
+            }
+            bottom = i;
+            left = std::min(left, row.first);
+            right = std::max(right, row.last);
+        }
+    }
+}
+
+void ImageDifference::merge(const ImageDifference& other) {
+    squared_sum += other.squared_sum;
+    max_difference = std::max(max_difference, other.max_difference);
+    if (other.differing_pixels == 0) {
+        return;
+    }
+    if (differing_pixels == 0) {
+        top = other.top;
+        left = other.left;
+        bottom = other.bottom;
+        right = other.right;
+    } else {
+        top = std::min(top, other.top);
+        left = std::min(left, other.left);
+        bottom = std::max(bottom, other.bottom);
+        right = std::max(right, other.right);
+    }
+    differing_pixels += other.differing_pixels;
+}
+
+template <typename Pixel>
+ImageDifference ImageDifference::compare_views(const BasicImageView<const Pixel>& a,
+                                               const BasicImageView<const Pixel>& b) {
+    if (a.get_width() != b.get_width() || a.get_height() != b.get_height()) {
+        throw std::invalid_argument("Images must have the same dimensions.");
+    }
+    const int width = a.get_width();
+    const int height = a.get_height();
+    ImageDifference result(width, height, PixelTraits<Pixel>::max_value);
+    if (width == 0 || height == 0) {
+        return result;
+    }
+
+    // A few chunks per thread keep the threads busy when some finish early; each chunk
+    // fills its own statistics, which are merged in order afterwards.
+    ThreadPool& pool = ThreadPool::shared();
+    const long long pixels = static_cast<long long>(width) * height;
+    int chunks = std::min(height, pool.get_thread_count() * 4);
+    chunks = static_cast<int>(std::max(1LL, std::min(static_cast<long long>(chunks), pixels / MIN_CHUNK_PIXELS)));
+    if (chunks == 1) {
+        result.add_rows(a, b, 0, height);
+        return result;
+    }
+    std::vector<ImageDifference> partial(chunks, result);
+    pool.parallel_for(chunks, [&](int c) {
+        partial[c].add_rows(a, b, static_cast<int>(static_cast<long long>(height) * c / chunks),
+                            static_cast<int>(static_cast<long long>(height) * (c + 1) / chunks));
+    });
+    for (int c = 0; c < chunks; ++c) {
+        result.merge(partial[c]);
+    }
+    return result;
+}
+
+ImageDifference ImageDifference::compare(const ConstImageView& a, const ConstImageView& b) {
+    return compare_views(a, b);
+}
+
+ImageDifference ImageDifference::compare(const ConstImageView16& a, const ConstImageView16& b) {
+    return compare_views(a, b);
+}
+
+double ImageDifference::get_mse() const {
+    if (width == 0 || height == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(squared_sum) / (static_cast<double>(width) * height);
+}
+
+double ImageDifference::get_psnr() const {
+    double mse = get_mse();
+    if (mse == 0.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return 10.0 * std::log10(static_cast<double>(peak) * peak / mse);
+}
@@ -0,0 +1,70 @@
+#ifndef IMAGE_DIFFERENCE_H
+#define IMAGE_DIFFERENCE_H
+
+#include <cstdint>
+
+#include "ImageView.h"
+
+// How far apart two images of the same size are: mean squared error, PSNR, the largest
+// per-pixel difference, how many pixels differ and the box that encloses them.
+// compare() gathers everything in one pass over both images. 8-bit and 16-bit images are
+// compared in their own gray levels.
+class ImageDifference {
+private:
+    int width;
+    int height;
+    int peak;                   // Largest pixel value, 255 or 65535
+    uint64_t squared_sum;       // Sum of the squared pixel differences
+    int max_difference;
+    long long differing_pixels;
+    int top, left, bottom, right;   // Inclusive bounding box of the differing pixels, -1 if none
+
+    // Statistics of no pixels at all, for an image of the given size
+    ImageDifference(int width, int height, int peak);
+
+    // Adds the rows [first, last) of a and b to the statistics
+    template <typename Pixel>
+    void add_rows(const BasicImageView<const Pixel>& a, const BasicImageView<const Pixel>& b, int first, int last);
+
+    // compare() for either pixel type
+    template <typename Pixel>
+    static ImageDifference compare_views(const BasicImageView<const Pixel>& a, const BasicImageView<const Pixel>& b);
+
+    // Adds the statistics of another set of rows of the same images
+    void merge(const ImageDifference& other);
+
+public:
+    // Compares a and b, using the shared thread pool for large images.
+    // Throws std::invalid_argument if they do not have the same size.
+    static ImageDifference compare(const ConstImageView& a, const ConstImageView& b);
+    static ImageDifference compare(const ConstImageView16& a, const ConstImageView16& b);
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+
+    // Mean of the squared differences over all pixels (0 for an empty image)
+    double get_mse() const;
+
+    // Peak signal-to-noise ratio in dB, 10 log10(peak^2 / MSE) with a peak of 255 for 8-bit and
+    // 65535 for 16-bit images; infinity for identical images
+    double get_psnr() const;
+
+    // Largest |a - b| over all pixels
+    int get_max_difference() const { return max_difference; }
+
+    // Number of pixels where a and b differ
+    long long get_differing_pixels() const { return differing_pixels; }
+
+    // Bounding box of the differing pixels, inclusive; all -1 for identical images
+    int get_top() const { return top; }
+    int get_left() const { return left; }
+    int get_bottom() const { return bottom; }
+    int get_right() const { return right; }
+
+    bool is_identical() const { return differing_pixels == 0; }
+
+    // True if no pixel differs by more than tolerance
+    bool is_within(int tolerance) const { return max_difference <= tolerance; }
+};
+
+#endif // IMAGE_DIFFERENCE_H
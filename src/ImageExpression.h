@@ -0,0 +1,391 @@
+#ifndef IMAGE_EXPRESSION_H
+#define IMAGE_EXPRESSION_H
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "ImageView.h"
+#include "PixelKernels.h"
+#include "PixelTraits.h"
+
+// Lazy image arithmetic. a + b - c on images or views does not compute anything by itself;
+// it builds a small tree of ImageExpression nodes that is evaluated row by row, in one pass,
+// when it is assigned to a GrayscaleImage. Each node still applies its operation to whole
+// rows with the same saturating kernel as before, so ((a + b) - c) clamps after the addition
+// exactly like the step-by-step version did.
+//
+// Expressions refer to their images, they do not copy them: evaluate an expression before
+// the images it uses go away, and do not keep one in an auto variable.
+//
+// Images and views of any pixel type take part, but both operands of a node must have the
+// same one. 8-bit rows run on the PixelKernels vector kernels; the other pixel types use the
+// generic loops below, which saturate (integers) or not (float) as PixelTraits says.
+
+template <typename Pixel>
+class BasicGrayscaleImage;
+
+// Leaf of an expression tree: the pixels seen through a view
+template <typename Pixel>
+class BasicImageOperand {
+private:
+    BasicImageView<const Pixel> view;
+
+public:
+    typedef Pixel pixel_type;
+
+    explicit BasicImageOperand(const BasicImageView<const Pixel>& view) : view(view) {}
+
+    int get_width() const { return view.get_width(); }
+    int get_height() const { return view.get_height(); }
+
+    // A leaf's row is read in place, nothing is computed
+    const Pixel* evaluate_row(int row) const { return view.get_row(row); }
+};
+
+typedef BasicImageOperand<uint8_t> ImageOperand;
+
+// Operations of the binary nodes; each works on a whole row of n pixels. The uint8_t overloads
+// run the vector kernels, the templates serve the wider pixel types.
+struct SaturatingAdd {
+    void apply(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) const {
+        PixelKernels::add_saturate(a, b, out, n);
+    }
+
+    template <typename Pixel>
+    void apply(const Pixel* a, const Pixel* b, Pixel* out, int n) const {
+        typedef PixelTraits<Pixel> Traits;
+        for (int i = 0; i < n; ++i) {
+            out[i] = Traits::clamp(static_cast<typename Traits::sum_type>(a[i]) + b[i]);
+        }
+    }
+};
+
+struct SaturatingSubtract {
+    void apply(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) const {
+        PixelKernels::subtract_saturate(a, b, out, n);
+    }
+
+    template <typename Pixel>
+    void apply(const Pixel* a, const Pixel* b, Pixel* out, int n) const {
+        typedef PixelTraits<Pixel> Traits;
+        for (int i = 0; i < n; ++i) {
+            out[i] = Traits::clamp(static_cast<typename Traits::sum_type>(a[i]) - b[i]);
+        }
+    }
+};
+
+struct AbsoluteDifference {
+    void apply(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) const {
+        PixelKernels::absolute_difference(a, b, out, n);
+    }
+
+    template <typename Pixel>
+    void apply(const Pixel* a, const Pixel* b, Pixel* out, int n) const {
+        for (int i = 0; i < n; ++i) {
+            out[i] = static_cast<Pixel>(a[i] > b[i] ? a[i] - b[i] : b[i] - a[i]);
+        }
+    }
+};
+
+struct Blend {
+    double alpha;   // Weight of the first operand; the second one gets 1 - alpha
+
+    // 8-bit pixels go through the single precision vector kernels
+    void apply(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) const {
+        PixelKernels::blend(a, b, static_cast<float>(alpha), out, n);
+    }
+
+    template <typename Pixel>
+    void apply(const Pixel* a, const Pixel* b, Pixel* out, int n) const {
+        const double beta = 1.0 - alpha;
+        for (int i = 0; i < n; ++i) {
+            out[i] = PixelTraits<Pixel>::from_double_rounded(alpha * a[i] + beta * b[i]);
+        }
+    }
+};
+
+// Operations of the scalar nodes
+struct SaturatingAddScalar {
+    int value;      // Added to every pixel; negative values subtract
+
+    void apply(const uint8_t* a, uint8_t* out, int n) const {
+        if (value >= 0) {
+            PixelKernels::add_scalar_saturate(a, static_cast<uint8_t>(value > 255 ? 255 : value), out, n);
+        } else {
+            PixelKernels::subtract_scalar_saturate(a, static_cast<uint8_t>(value < -255 ? 255 : -value), out, n);
+        }
+    }
+
+    template <typename Pixel>
+    void apply(const Pixel* a, Pixel* out, int n) const {
+        typedef PixelTraits<Pixel> Traits;
+        for (int i = 0; i < n; ++i) {
+            out[i] = Traits::clamp(static_cast<typename Traits::sum_type>(a[i]) + value);
+        }
+    }
+};
+
+struct Scale {
+    double factor;
+
+    // 8-bit pixels go through the single precision vector kernels
+    void apply(const uint8_t* a, uint8_t* out, int n) const {
+        PixelKernels::scale(a, static_cast<float>(factor), out, n);
+    }
+
+    template <typename Pixel>
+    void apply(const Pixel* a, Pixel* out, int n) const {
+        for (int i = 0; i < n; ++i) {
+            out[i] = PixelTraits<Pixel>::from_double_rounded(factor * a[i]);
+        }
+    }
+};
+
+// Binary node: Operation applied to the results of Left and Right. Left and Right are either
+// a BasicImageOperand or another expression node, held by value (they are only a few pointers).
+template <typename Operation, typename Left, typename Right>
+class ImageExpression {
+public:
+    typedef typename Left::pixel_type pixel_type;
+
+private:
+    Left left;
+    Right right;
+    Operation operation;
+    mutable std::vector<pixel_type> row_buffer;     // This node's result for the row being evaluated
+
+public:
+    // Throws std::invalid_argument unless both operands have the same size
+    ImageExpression(const Left& left, const Right& right, const Operation& operation = Operation())
+            : left(left), right(right), operation(operation) {
+        if (left.get_width() != right.get_width() || left.get_height() != right.get_height()) {
+            throw std::invalid_argument("Images must have the same dimensions.");
+        }
+    }
+
+    int get_width() const { return left.get_width(); }
+    int get_height() const { return left.get_height(); }
+
+    // Computes one row of the result and returns it; valid until the next call.
+    const pixel_type* evaluate_row(int row) const {
+        const pixel_type* a = left.evaluate_row(row);
+        const pixel_type* b = right.evaluate_row(row);
+        row_buffer.resize(get_width());
+        operation.apply(a, b, &row_buffer[0], get_width());
+        return &row_buffer[0];
+    }
+
+    // Writes the whole result into out, which must have the same size. Each row is finished
+    // in this node's buffer before it is copied out, so out may be one of the operands.
+    void evaluate_into(const BasicImageView<pixel_type>& out) const {
+        if (out.get_width() != get_width() || out.get_height() != get_height()) {
+            throw std::invalid_argument("Images must have the same dimensions.");
+        }
+        if (get_width() == 0) {
+            return;
+        }
+        for (int row = 0; row < get_height(); ++row) {
+            std::memcpy(out.get_row(row), evaluate_row(row), sizeof(pixel_type) * get_width());
+        }
+    }
+};
+
+// Scalar node: Operation, which carries its scalar, applied to the result of Operand
+template <typename Operation, typename Operand>
+class ImageScalarExpression {
+public:
+    typedef typename Operand::pixel_type pixel_type;
+
+private:
+    Operand operand;
+    Operation operation;
+    mutable std::vector<pixel_type> row_buffer;
+
+public:
+    ImageScalarExpression(const Operand& operand, const Operation& operation)
+            : operand(operand), operation(operation) {}
+
+    int get_width() const { return operand.get_width(); }
+    int get_height() const { return operand.get_height(); }
+
+    const pixel_type* evaluate_row(int row) const {
+        const pixel_type* a = operand.evaluate_row(row);
+        row_buffer.resize(get_width());
+        operation.apply(a, &row_buffer[0], get_width());
+        return &row_buffer[0];
+    }
+
+    void evaluate_into(const BasicImageView<pixel_type>& out) const {
+        if (out.get_width() != get_width() || out.get_height() != get_height()) {
+            throw std::invalid_argument("Images must have the same dimensions.");
+        }
+        if (get_width() == 0) {
+            return;
+        }
+        for (int row = 0; row < get_height(); ++row) {
+            std::memcpy(out.get_row(row), evaluate_row(row), sizeof(pixel_type) * get_width());
+        }
+    }
+};
+
+template <typename T>
+struct is_image_expression : std::false_type {};
+
+template <typename Operation, typename Left, typename Right>
+struct is_image_expression<ImageExpression<Operation, Left, Right> > : std::true_type {};
+
+template <typename Operation, typename Operand>
+struct is_image_expression<ImageScalarExpression<Operation, Operand> > : std::true_type {};
+
+// Pixel type of anything that can take part in image arithmetic: an expression, an image or
+// a view; there is no type member for anything else
+template <typename T>
+struct image_pixel_type {};
+
+template <typename T>
+struct image_pixel_type<BasicImageView<T> > {
+    typedef typename std::remove_const<T>::type type;
+};
+
+template <typename Pixel>
+struct image_pixel_type<BasicGrayscaleImage<Pixel> > {
+    typedef Pixel type;
+};
+
+template <typename Operation, typename Left, typename Right>
+struct image_pixel_type<ImageExpression<Operation, Left, Right> > {
+    typedef typename ImageExpression<Operation, Left, Right>::pixel_type type;
+};
+
+template <typename Operation, typename Operand>
+struct image_pixel_type<ImageScalarExpression<Operation, Operand> > {
+    typedef typename ImageScalarExpression<Operation, Operand>::pixel_type type;
+};
+
+// True for images, views and expressions of any pixel type
+template <typename T, typename = void>
+struct is_image_operand : std::false_type {};
+
+template <typename T>
+struct is_image_operand<T, typename std::conditional<true, void, typename image_pixel_type<T>::type>::type>
+        : std::true_type {};
+
+// True if T is an expression that evaluates to pixels of type Pixel
+template <typename T, typename Pixel, bool = is_image_expression<T>::value>
+struct is_image_expression_of : std::false_type {};
+
+template <typename T, typename Pixel>
+struct is_image_expression_of<T, Pixel, true> : std::is_same<typename T::pixel_type, Pixel> {};
+
+// How an operand is stored in an expression node: expressions as they are, images and views
+// as a BasicImageOperand leaf
+template <typename T, bool = is_image_expression<T>::value>
+struct ImageExpressionNode {
+    typedef typename image_pixel_type<T>::type pixel_type;
+    typedef BasicImageOperand<pixel_type> type;
+    static type make(const T& operand) { return type(operand); }
+};
+
+template <typename T>
+struct ImageExpressionNode<T, true> {
+    typedef T type;
+    static const T& make(const T& operand) { return operand; }
+};
+
+// The node type built by combining L and R with Operation; only exists for image operands
+// with the same pixel type
+template <typename Operation, typename L, typename R,
+          bool = is_image_operand<L>::value && is_image_operand<R>::value>
+struct ImageExpressionResult {};
+
+template <typename Operation, typename L, typename R>
+struct ImageExpressionResult<Operation, L, R, true>
+        : std::enable_if<std::is_same<typename image_pixel_type<L>::type, typename image_pixel_type<R>::type>::value,
+                         ImageExpression<Operation, typename ImageExpressionNode<L>::type,
+                                         typename ImageExpressionNode<R>::type> > {};
+
+// The node type built by applying the scalar Operation to A; only exists for image operands
+template <typename Operation, typename A, bool = is_image_operand<A>::value>
+struct ImageScalarExpressionResult {};
+
+template <typename Operation, typename A>
+struct ImageScalarExpressionResult<Operation, A, true> {
+    typedef ImageScalarExpression<Operation, typename ImageExpressionNode<A>::type> type;
+};
+
+template <typename Operation, typename L, typename R>
+typename ImageExpressionResult<Operation, L, R>::type make_image_expression(const L& a, const R& b,
+                                                                            const Operation& operation) {
+    return typename ImageExpressionResult<Operation, L, R>::type(ImageExpressionNode<L>::make(a),
+                                                                  ImageExpressionNode<R>::make(b), operation);
+}
+
+template <typename Operation, typename A>
+typename ImageScalarExpressionResult<Operation, A>::type make_image_expression(const A& a,
+                                                                               const Operation& operation) {
+    return typename ImageScalarExpressionResult<Operation, A>::type(ImageExpressionNode<A>::make(a), operation);
+}
+
+// Saturating a + b
+template <typename L, typename R>
+typename ImageExpressionResult<SaturatingAdd, L, R>::type operator+(const L& a, const R& b) {
+    return make_image_expression(a, b, SaturatingAdd());
+}
+
+// Saturating a - b
+template <typename L, typename R>
+typename ImageExpressionResult<SaturatingSubtract, L, R>::type operator-(const L& a, const R& b) {
+    return make_image_expression(a, b, SaturatingSubtract());
+}
+
+// |a - b|
+template <typename L, typename R>
+typename ImageExpressionResult<AbsoluteDifference, L, R>::type absolute_difference(const L& a, const R& b) {
+    return make_image_expression(a, b, AbsoluteDifference());
+}
+
+// alpha * a + (1 - alpha) * b, rounded half up and clamped to the pixel range (in single
+// precision for 8-bit pixels, in double precision otherwise)
+template <typename L, typename R>
+typename ImageExpressionResult<Blend, L, R>::type blend(const L& a, const R& b, double alpha) {
+    Blend operation = { alpha };
+    return make_image_expression(a, b, operation);
+}
+
+// Saturating a + value and value + a
+template <typename A>
+typename ImageScalarExpressionResult<SaturatingAddScalar, A>::type operator+(const A& a, int value) {
+    SaturatingAddScalar operation = { value };
+    return make_image_expression(a, operation);
+}
+
+template <typename A>
+typename ImageScalarExpressionResult<SaturatingAddScalar, A>::type operator+(int value, const A& a) {
+    return a + value;
+}
+
+// Saturating a - value
+template <typename A>
+typename ImageScalarExpressionResult<SaturatingAddScalar, A>::type operator-(const A& a, int value) {
+    SaturatingAddScalar operation = { value == INT_MIN ? INT_MAX : -value };
+    return make_image_expression(a, operation);
+}
+
+// factor * a, rounded half up and clamped to the pixel range (in single precision for 8-bit
+// pixels, in double precision otherwise)
+template <typename A>
+typename ImageScalarExpressionResult<Scale, A>::type operator*(const A& a, double factor) {
+    Scale operation = { factor };
+    return make_image_expression(a, operation);
+}
+
+template <typename A>
+typename ImageScalarExpressionResult<Scale, A>::type operator*(double factor, const A& a) {
+    return a * factor;
+}
+
+#endif // IMAGE_EXPRESSION_H
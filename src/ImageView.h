@@ -0,0 +1,74 @@
+#ifndef IMAGE_VIEW_H
+#define IMAGE_VIEW_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "PixelTraits.h"
+
+// Non-owning window onto rows of pixels: a pointer to the first pixel, the
+// visible width and height, and the distance between two rows (stride).
+// A view never allocates or frees anything; the image it points into must
+// outlive it. T is the pixel type (see PixelTraits) for a mutable view and
+// the const pixel type for a read-only one.
+template <typename T>
+class BasicImageView {
+private:
+    T* pixels;
+    int width, height;
+    int stride;
+
+public:
+    typedef typename std::remove_const<T>::type pixel_type;
+    typedef typename PixelTraits<pixel_type>::value_type value_type;
+
+    // Constructor: empty view
+    BasicImageView() : pixels(nullptr), width(0), height(0), stride(0) {}
+
+    // Constructor: describes h rows of w pixels starting at data, stride pixels apart
+    BasicImageView(T* data, int w, int h, int row_stride)
+            : pixels(data), width(w), height(h), stride(row_stride) {}
+
+    // Converting constructor: a mutable view can always be used as a read-only one
+    template <typename U>
+    BasicImageView(const BasicImageView<U>& other,
+                   typename std::enable_if<std::is_convertible<U*, T*>::value>::type* = nullptr)
+            : pixels(other.get_pixels()), width(other.get_width()),
+              height(other.get_height()), stride(other.get_stride()) {}
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_stride() const { return stride; }
+
+    // Pointer to the first visible pixel
+    T* get_pixels() const { return pixels; }
+
+    // Pointer to the first pixel of the given row
+    T* get_row(int row) const { return pixels + static_cast<long>(row) * stride; }
+
+    value_type get_pixel(int row, int col) const { return get_row(row)[col]; }
+
+    // Returns the h x w sub-rectangle whose top-left corner is (row, col).
+    BasicImageView region(int row, int col, int h, int w) const {
+        if (row < 0 || col < 0 || h < 0 || w < 0 || row + h > height || col + w > width) {
+            throw std::out_of_range("Region lies outside the image view.");
+        }
+        return BasicImageView(get_row(row) + col, w, h, stride);
+    }
+
+    // True if both views have the same dimensions
+    template <typename U>
+    bool same_size(const BasicImageView<U>& other) const {
+        return width == other.get_width() && height == other.get_height();
+    }
+};
+
+typedef BasicImageView<uint8_t> ImageView;
+typedef BasicImageView<const uint8_t> ConstImageView;
+typedef BasicImageView<uint16_t> ImageView16;
+typedef BasicImageView<const uint16_t> ConstImageView16;
+typedef BasicImageView<float> ImageViewF;
+typedef BasicImageView<const float> ConstImageViewF;
+
+#endif // IMAGE_VIEW_H
@@ -0,0 +1,1536 @@
+#include "PixelKernels.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CLEARVISION_X86 1
+#include <immintrin.h>
+#endif
+
+// Lets one translation unit hold code for several instruction sets; the caller
+// checks at runtime that the CPU supports one before calling into it.
+#if defined(__GNUC__)
+#define CLEARVISION_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CLEARVISION_TARGET(isa)
+#endif
+
+// The convolution kernels are templates on their tap count: Taps > 0 fixes it at compile time,
+// so the tap loops unroll and the weights can stay in registers; Taps == 0 takes it at run time
+template <int Taps>
+static inline int tap_count(int taps) {
+    return Taps > 0 ? Taps : taps;
+}
+
+// Calls kernel<3>, kernel<5> or kernel<7> for those tap counts (the usual 3x3 to 7x7 kernels)
+// and kernel<0> for the rest
+#define CLEARVISION_DISPATCH_TAPS(kernel, taps, ...)      \
+    switch (taps) {                                       \
+    case 3: kernel<3>(__VA_ARGS__); break;                \
+    case 5: kernel<5>(__VA_ARGS__); break;                \
+    case 7: kernel<7>(__VA_ARGS__); break;                \
+    default: kernel<0>(__VA_ARGS__); break;               \
+    }
+
+// Portable versions
+
+static void add_saturate_scalar(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        int pixel_value = static_cast<int>(a[i]) + b[i];
+        out[i] = static_cast<uint8_t>(pixel_value > 255 ? 255 : pixel_value);
+    }
+}
+
+static void subtract_saturate_scalar(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        int pixel_value = static_cast<int>(a[i]) - b[i];
+        out[i] = static_cast<uint8_t>(pixel_value < 0 ? 0 : pixel_value);
+    }
+}
+
+static bool equal_scalar(const uint8_t* a, const uint8_t* b, int n) {
+    return n <= 0 || std::memcmp(a, b, n) == 0;
+}
+
+// Bit scans used to locate differing pixels from a comparison mask (x != 0)
+#if defined(__GNUC__)
+static inline int count_bits(uint64_t x) { return __builtin_popcountll(x); }
+static inline int lowest_bit(uint64_t x) { return __builtin_ctzll(x); }
+static inline int highest_bit(uint64_t x) { return 63 - __builtin_clzll(x); }
+#else
+static inline int count_bits(uint64_t x) {
+    int count = 0;
+    for (; x != 0; x &= x - 1) {
+        ++count;
+    }
+    return count;
+}
+static inline int lowest_bit(uint64_t x) {
+    int bit = 0;
+    for (; (x & 1) == 0; x >>= 1) {
+        ++bit;
+    }
+    return bit;
+}
+static inline int highest_bit(uint64_t x) {
+    int bit = 63;
+    for (; (x >> 63) == 0; x <<= 1) {
+        --bit;
+    }
+    return bit;
+}
+#endif
+
+// Folds the differing pixels of one block, given as a bit mask, into stats
+static inline void add_difference_mask(uint64_t mask, int offset, PixelKernels::RowDifference& stats) {
+    if (mask == 0) {
+        return;
+    }
+    stats.differing += count_bits(mask);
+    if (stats.first < 0) {
+        stats.first = offset + lowest_bit(mask);
+    }
+    stats.last = offset + highest_bit(mask);
+}
+
+static void difference_row_scalar(const uint8_t* a, const uint8_t* b, int n, PixelKernels::RowDifference& stats) {
+    stats.squared_sum = 0;
+    stats.max_difference = 0;
+    stats.differing = 0;
+    stats.first = stats.last = -1;
+    for (int i = 0; i < n; ++i) {
+        int difference = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        if (difference != 0) {
+            stats.squared_sum += static_cast<uint64_t>(difference * difference);
+            stats.max_difference = difference > stats.max_difference ? difference : stats.max_difference;
+            stats.differing += 1;
+            if (stats.first < 0) {
+                stats.first = i;
+            }
+            stats.last = i;
+        }
+    }
+}
+
+// Merges the statistics of a row's tail (which starts at offset) into those of its head
+static inline void merge_difference_tail(PixelKernels::RowDifference& stats, const PixelKernels::RowDifference& tail,
+                                         int offset) {
+    stats.squared_sum += tail.squared_sum;
+    stats.max_difference = tail.max_difference > stats.max_difference ? tail.max_difference : stats.max_difference;
+    stats.differing += tail.differing;
+    if (tail.first >= 0) {
+        if (stats.first < 0) {
+            stats.first = offset + tail.first;
+        }
+        stats.last = offset + tail.last;
+    }
+}
+
+template <int Taps>
+static void convolve_row_scalar_taps(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    taps = tap_count<Taps>(taps);
+    for (int i = 0; i < n; ++i) {
+        const uint8_t* window = padded + i;
+        double sum = out[i];
+        for (int t = 0; t < taps; ++t) {
+            sum += weights[t] * window[t];
+        }
+        out[i] = sum;
+    }
+}
+
+// Outputs [first, n) of the vertical pass; the SIMD versions finish their rows with it
+template <int Taps>
+static void convolve_column_from(const double* const* rows, const double* weights, int taps, double* out,
+                                 int first, int n) {
+    taps = tap_count<Taps>(taps);
+    for (int i = first; i < n; ++i) {
+        double sum = 0.0;
+        for (int t = 0; t < taps; ++t) {
+            sum += weights[t] * rows[t][i];
+        }
+        out[i] = sum;
+    }
+}
+
+static void convolve_column_scalar(const double* const* rows, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_from, taps, rows, weights, taps, out, 0, n)
+}
+
+static void floor_row_scalar(const double* in, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        out[i] = in[i] <= 0.0 ? 0 : (in[i] >= 255.0 ? 255 : static_cast<uint8_t>(in[i]));
+    }
+}
+
+// Unsharp mask of one row: the blurred value is rounded down to a pixel first, as if the
+// blur had been stored, then original + amount * (original - blurred) is rounded down and
+// clamped like floor_row
+static void unsharp_row_scalar(const uint8_t* original, const double* blurred, double amount, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        const int blurred_pixel = blurred[i] <= 0.0 ? 0 : (blurred[i] >= 255.0 ? 255 : static_cast<int>(blurred[i]));
+        const double value = original[i] + amount * (original[i] - blurred_pixel);
+        out[i] = value <= 0.0 ? 0 : (value >= 255.0 ? 255 : static_cast<uint8_t>(value));
+    }
+}
+
+// Fixed-point Gaussian: the horizontal pass drops FIXED_ROW_SHIFT bits (rounding to nearest), the
+// vertical pass drops the remaining FIXED_COLUMN_SHIFT (rounding down)
+static const int FIXED_ROW_SHIFT = PixelKernels::FIXED_WEIGHT_BITS - PixelKernels::FIXED_ROW_BITS;
+static const int FIXED_COLUMN_SHIFT = PixelKernels::FIXED_WEIGHT_BITS + PixelKernels::FIXED_ROW_BITS;
+
+template <int Taps>
+static void convolve_row_fixed_scalar_taps(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    taps = tap_count<Taps>(taps);
+    for (int i = 0; i < n; ++i) {
+        int32_t sum = 1 << (FIXED_ROW_SHIFT - 1);
+        for (int t = 0; t < taps; ++t) {
+            sum += weights[t] * padded[i + t];
+        }
+        out[i] = static_cast<int16_t>(sum >> FIXED_ROW_SHIFT);
+    }
+}
+
+// Outputs [first, n) of the column pass; the SIMD versions finish their rows with it
+template <int Taps>
+static void convolve_column_fixed_from(const int16_t* const* rows, const int16_t* weights, int taps,
+                                       uint8_t* out, int first, int n) {
+    taps = tap_count<Taps>(taps);
+    for (int i = first; i < n; ++i) {
+        int32_t sum = 0;
+        for (int t = 0; t < taps; ++t) {
+            sum += weights[t] * rows[t][i];
+        }
+        sum >>= FIXED_COLUMN_SHIFT;
+        out[i] = static_cast<uint8_t>(sum < 0 ? 0 : (sum > 255 ? 255 : sum));
+    }
+}
+
+static void convolve_row_scalar(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_scalar_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_row_fixed_scalar(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_fixed_scalar_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_column_fixed_scalar(const int16_t* const* rows, const int16_t* weights, int taps,
+                                         uint8_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_fixed_from, taps, rows, weights, taps, out, 0, n)
+}
+
+// Two neighbouring taps as one pmaddwd operand: weights[t] in the low and weights[t + 1] (0 past
+// the last tap) in the high 16 bits of each 32-bit lane
+static inline int32_t weight_pair(const int16_t* weights, int t, int taps) {
+    const uint32_t low = static_cast<uint16_t>(weights[t]);
+    const uint32_t high = t + 1 < taps ? static_cast<uint16_t>(weights[t + 1]) : 0;
+    return static_cast<int32_t>(high << 16 | low);
+}
+
+static void extract_lsb_scalar(const uint8_t* pixels, int* bits, int n) {
+    for (int i = 0; i < n; ++i) {
+        bits[i] = pixels[i] & 1;
+    }
+}
+
+static void embed_lsb_scalar(uint8_t* pixels, const int* bits, int n) {
+    for (int i = 0; i < n; ++i) {
+        pixels[i] = static_cast<uint8_t>((pixels[i] & ~1) | (bits[i] & 1));
+    }
+}
+
+static void add_scalar_saturate_scalar(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        int pixel_value = static_cast<int>(a[i]) + value;
+        out[i] = static_cast<uint8_t>(pixel_value > 255 ? 255 : pixel_value);
+    }
+}
+
+static void subtract_scalar_saturate_scalar(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        int pixel_value = static_cast<int>(a[i]) - value;
+        out[i] = static_cast<uint8_t>(pixel_value < 0 ? 0 : pixel_value);
+    }
+}
+
+static void absolute_difference_scalar(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        out[i] = static_cast<uint8_t>(a[i] > b[i] ? a[i] - b[i] : b[i] - a[i]);
+    }
+}
+
+// value already has the 0.5 added; clamping first makes truncation round half up
+static inline uint8_t round_clamp(float value) {
+    value = value < 0.0f ? 0.0f : value;
+    value = value > 255.0f ? 255.0f : value;
+    return static_cast<uint8_t>(static_cast<int>(value));
+}
+
+static void scale_scalar(const uint8_t* a, float factor, uint8_t* out, int n) {
+    for (int i = 0; i < n; ++i) {
+        float product = factor * a[i];
+        out[i] = round_clamp(product + 0.5f);
+    }
+}
+
+static void blend_scalar(const uint8_t* a, const uint8_t* b, float alpha, uint8_t* out, int n) {
+    const float beta = 1.0f - alpha;
+    for (int i = 0; i < n; ++i) {
+        float weighted_a = alpha * a[i];
+        float weighted_b = beta * b[i];
+        float sum = weighted_a + weighted_b;
+        out[i] = round_clamp(sum + 0.5f);
+    }
+}
+
+#ifdef CLEARVISION_X86
+
+// The floating point kernels vectorise across output pixels: lane i computes exactly the
+// sequence of operations the scalar loop does for pixel i. Multiplies and adds are kept as
+// separate instructions, since a fused multiply-add rounds once instead of twice and would
+// change results. The rows they produce can be negative (Filter::convolve takes signed
+// kernels), and truncating a negative value rounds it towards zero rather than down. The
+// integer conversions are only correct because they clamp to [0, 255] first, like
+// floor_row_scalar: what gets truncated is never negative, so truncating is flooring.
+
+// SSE2: 16 pixels or 2 doubles per instruction
+
+CLEARVISION_TARGET("sse2")
+static void add_saturate_sse2(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_adds_epu8(x, y));
+    }
+    add_saturate_scalar(a + i, b + i, out + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static void subtract_saturate_sse2(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_subs_epu8(x, y));
+    }
+    subtract_saturate_scalar(a + i, b + i, out + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static bool equal_sse2(const uint8_t* a, const uint8_t* b, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+            return false;
+        }
+    }
+    return equal_scalar(a + i, b + i, n - i);
+}
+
+// The squares are summed in 32-bit lanes, which are emptied into the 64-bit total
+// often enough that they cannot overflow.
+static const int DIFFERENCE_FLUSH_BLOCKS = 2048;
+
+CLEARVISION_TARGET("sse2")
+static inline uint64_t sum_epi32_sse2(__m128i x) {
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), x);
+    return static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+
+CLEARVISION_TARGET("sse2")
+static void difference_row_sse2(const uint8_t* a, const uint8_t* b, int n, PixelKernels::RowDifference& stats) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i max_difference = zero;
+    __m128i squares = zero;
+    stats.squared_sum = 0;
+    stats.differing = 0;
+    stats.first = stats.last = -1;
+    int i = 0;
+    for (int block = 1; i + 16 <= n; i += 16, ++block) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i d = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+        max_difference = _mm_max_epu8(max_difference, d);
+        __m128i lo = _mm_unpacklo_epi8(d, zero);
+        __m128i hi = _mm_unpackhi_epi8(d, zero);
+        squares = _mm_add_epi32(squares, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        add_difference_mask(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(d, zero))) ^ 0xFFFFu, i, stats);
+        if (block % DIFFERENCE_FLUSH_BLOCKS == 0) {
+            stats.squared_sum += sum_epi32_sse2(squares);
+            squares = zero;
+        }
+    }
+    stats.squared_sum += sum_epi32_sse2(squares);
+    uint8_t lanes[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), max_difference);
+    stats.max_difference = 0;
+    for (int k = 0; k < 16; ++k) {
+        stats.max_difference = lanes[k] > stats.max_difference ? lanes[k] : stats.max_difference;
+    }
+
+    PixelKernels::RowDifference tail;
+    difference_row_scalar(a + i, b + i, n - i, tail);
+    merge_difference_tail(stats, tail, i);
+}
+
+// Four pixels widened to four 32-bit integers
+CLEARVISION_TARGET("sse2")
+static inline __m128i load4_epu8_sse2(const uint8_t* p) {
+    int32_t bytes;
+    std::memcpy(&bytes, p, 4);
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+}
+
+template <int Taps>
+CLEARVISION_TARGET("sse2")
+static void convolve_row_sse2_taps(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    taps = tap_count<Taps>(taps);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d sum_lo = _mm_loadu_pd(out + i);
+        __m128d sum_hi = _mm_loadu_pd(out + i + 2);
+        for (int t = 0; t < taps; ++t) {
+            __m128i x = load4_epu8_sse2(padded + i + t);
+            __m128d w = _mm_set1_pd(weights[t]);
+            sum_lo = _mm_add_pd(sum_lo, _mm_mul_pd(w, _mm_cvtepi32_pd(x)));
+            sum_hi = _mm_add_pd(sum_hi, _mm_mul_pd(w, _mm_cvtepi32_pd(_mm_srli_si128(x, 8))));
+        }
+        _mm_storeu_pd(out + i, sum_lo);
+        _mm_storeu_pd(out + i + 2, sum_hi);
+    }
+    convolve_row_scalar_taps<Taps>(padded + i, weights, taps, out + i, n - i);
+}
+
+template <int Taps>
+CLEARVISION_TARGET("sse2")
+static void convolve_column_sse2_from(const double* const* rows, const double* weights, int taps, double* out,
+                                      int first, int n) {
+    taps = tap_count<Taps>(taps);
+    int i = first;
+    for (; i + 4 <= n; i += 4) {
+        __m128d sum_lo = _mm_setzero_pd();
+        __m128d sum_hi = _mm_setzero_pd();
+        for (int t = 0; t < taps; ++t) {
+            __m128d w = _mm_set1_pd(weights[t]);
+            sum_lo = _mm_add_pd(sum_lo, _mm_mul_pd(w, _mm_loadu_pd(rows[t] + i)));
+            sum_hi = _mm_add_pd(sum_hi, _mm_mul_pd(w, _mm_loadu_pd(rows[t] + i + 2)));
+        }
+        _mm_storeu_pd(out + i, sum_lo);
+        _mm_storeu_pd(out + i + 2, sum_hi);
+    }
+    convolve_column_from<Taps>(rows, weights, taps, out, i, n);
+}
+
+static void convolve_column_sse2(const double* const* rows, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_sse2_from, taps, rows, weights, taps, out, 0, n)
+}
+
+// Clamps two doubles to [0, 255] and rounds them down to two 32-bit integers
+CLEARVISION_TARGET("sse2")
+static inline __m128i floor_clamp_pd_sse2(__m128d x) {
+    return _mm_cvttpd_epi32(_mm_min_pd(_mm_max_pd(x, _mm_setzero_pd()), _mm_set1_pd(255.0)));
+}
+
+CLEARVISION_TARGET("sse2")
+static void floor_row_sse2(const double* in, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_unpacklo_epi64(floor_clamp_pd_sse2(_mm_loadu_pd(in + i)),
+                                       floor_clamp_pd_sse2(_mm_loadu_pd(in + i + 2)));
+        __m128i b = _mm_unpacklo_epi64(floor_clamp_pd_sse2(_mm_loadu_pd(in + i + 4)),
+                                       floor_clamp_pd_sse2(_mm_loadu_pd(in + i + 6)));
+        __m128i words = _mm_packs_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+    }
+    floor_row_scalar(in + i, out + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static void unsharp_row_sse2(const uint8_t* original, const double* blurred, double amount, uint8_t* out, int n) {
+    const __m128d a = _mm_set1_pd(amount);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = load4_epu8_sse2(original + i);
+        __m128i b = _mm_unpacklo_epi64(floor_clamp_pd_sse2(_mm_loadu_pd(blurred + i)),
+                                       floor_clamp_pd_sse2(_mm_loadu_pd(blurred + i + 2)));
+        __m128i d = _mm_sub_epi32(x, b);
+        __m128d lo = _mm_add_pd(_mm_cvtepi32_pd(x), _mm_mul_pd(a, _mm_cvtepi32_pd(d)));
+        __m128d hi = _mm_add_pd(_mm_cvtepi32_pd(_mm_srli_si128(x, 8)),
+                                _mm_mul_pd(a, _mm_cvtepi32_pd(_mm_srli_si128(d, 8))));
+        __m128i words = _mm_packs_epi32(_mm_unpacklo_epi64(floor_clamp_pd_sse2(lo), floor_clamp_pd_sse2(hi)),
+                                        _mm_setzero_si128());
+        const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(out + i, &bytes, 4);
+    }
+    unsharp_row_scalar(original + i, blurred + i, amount, out + i, n - i);
+}
+
+// Eight pixels widened to eight 16-bit integers
+CLEARVISION_TARGET("sse2")
+static inline __m128i load8_epu8_sse2(const uint8_t* p) {
+    return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), _mm_setzero_si128());
+}
+
+// pmaddwd on taps t and t + 1 at once: interleaving the two pixel rows pairs every pixel with
+// its right neighbour, and one multiply-add gives w0 * x[i + t] + w1 * x[i + t + 1] per lane
+template <int Taps>
+CLEARVISION_TARGET("sse2")
+static void convolve_row_fixed_sse2_taps(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    taps = tap_count<Taps>(taps);
+    const __m128i rounding = _mm_set1_epi32(1 << (FIXED_ROW_SHIFT - 1));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i sum_lo = rounding;
+        __m128i sum_hi = rounding;
+        for (int t = 0; t < taps; t += 2) {
+            __m128i w = _mm_set1_epi32(weight_pair(weights, t, taps));
+            __m128i a = load8_epu8_sse2(padded + i + t);
+            __m128i b = t + 1 < taps ? load8_epu8_sse2(padded + i + t + 1) : _mm_setzero_si128();
+            sum_lo = _mm_add_epi32(sum_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            sum_hi = _mm_add_epi32(sum_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        __m128i words = _mm_packs_epi32(_mm_srai_epi32(sum_lo, FIXED_ROW_SHIFT), _mm_srai_epi32(sum_hi, FIXED_ROW_SHIFT));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), words);
+    }
+    convolve_row_fixed_scalar_taps<Taps>(padded + i, weights, taps, out + i, n - i);
+}
+
+template <int Taps>
+CLEARVISION_TARGET("sse2")
+static void convolve_column_fixed_sse2_from(const int16_t* const* rows, const int16_t* weights, int taps,
+                                            uint8_t* out, int first, int n) {
+    taps = tap_count<Taps>(taps);
+    int i = first;
+    for (; i + 8 <= n; i += 8) {
+        __m128i sum_lo = _mm_setzero_si128();
+        __m128i sum_hi = _mm_setzero_si128();
+        for (int t = 0; t < taps; t += 2) {
+            __m128i w = _mm_set1_epi32(weight_pair(weights, t, taps));
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t] + i));
+            __m128i b = t + 1 < taps ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t + 1] + i))
+                                     : _mm_setzero_si128();
+            sum_lo = _mm_add_epi32(sum_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+            sum_hi = _mm_add_epi32(sum_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+        }
+        __m128i words = _mm_packs_epi32(_mm_srai_epi32(sum_lo, FIXED_COLUMN_SHIFT),
+                                        _mm_srai_epi32(sum_hi, FIXED_COLUMN_SHIFT));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+    }
+    convolve_column_fixed_from<Taps>(rows, weights, taps, out, i, n);
+}
+
+static void convolve_row_sse2(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_sse2_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_row_fixed_sse2(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_fixed_sse2_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_column_fixed_sse2(const int16_t* const* rows, const int16_t* weights, int taps,
+                                       uint8_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_fixed_sse2_from, taps, rows, weights, taps, out, 0, n)
+}
+
+CLEARVISION_TARGET("sse2")
+static void extract_lsb_sse2(const uint8_t* pixels, int* bits, int n) {
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i)), one);
+        __m128i lo = _mm_unpacklo_epi8(x, zero);
+        __m128i hi = _mm_unpackhi_epi8(x, zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits + i), _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits + i + 4), _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits + i + 8), _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits + i + 12), _mm_unpackhi_epi16(hi, zero));
+    }
+    extract_lsb_scalar(pixels + i, bits + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static void embed_lsb_sse2(uint8_t* pixels, const int* bits, int n) {
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i keep = _mm_set1_epi8(static_cast<char>(0xFE));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i* source = reinterpret_cast<const __m128i*>(bits + i);
+        __m128i a = _mm_and_si128(_mm_loadu_si128(source), one);
+        __m128i b = _mm_and_si128(_mm_loadu_si128(source + 1), one);
+        __m128i c = _mm_and_si128(_mm_loadu_si128(source + 2), one);
+        __m128i d = _mm_and_si128(_mm_loadu_si128(source + 3), one);
+        __m128i lsb = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        __m128i* target = reinterpret_cast<__m128i*>(pixels + i);
+        _mm_storeu_si128(target, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(target), keep), lsb));
+    }
+    embed_lsb_scalar(pixels + i, bits + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static void add_scalar_saturate_sse2(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    const __m128i y = _mm_set1_epi8(static_cast<char>(value));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_adds_epu8(x, y));
+    }
+    add_scalar_saturate_scalar(a + i, value, out + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static void subtract_scalar_saturate_sse2(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    const __m128i y = _mm_set1_epi8(static_cast<char>(value));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_subs_epu8(x, y));
+    }
+    subtract_scalar_saturate_scalar(a + i, value, out + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static void absolute_difference_sse2(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x)));
+    }
+    absolute_difference_scalar(a + i, b + i, out + i, n - i);
+}
+
+// Sixteen pixels widened to four vectors of four floats
+CLEARVISION_TARGET("sse2")
+static inline void load16_ps_sse2(const uint8_t* p, __m128 values[4]) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i lo = _mm_unpacklo_epi8(x, zero);
+    __m128i hi = _mm_unpackhi_epi8(x, zero);
+    values[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+    values[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+    values[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+    values[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+}
+
+// round_clamp on four vectors of four floats, packed into sixteen pixels
+CLEARVISION_TARGET("sse2")
+static inline void store16_round_clamp_sse2(uint8_t* p, const __m128 values[4]) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 max_value = _mm_set1_ps(255.0f);
+    __m128i words[4];
+    for (int k = 0; k < 4; ++k) {
+        words[k] = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(values[k], zero), max_value));
+    }
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(words[0], words[1]), _mm_packs_epi32(words[2], words[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), packed);
+}
+
+CLEARVISION_TARGET("sse2")
+static void scale_sse2(const uint8_t* a, float factor, uint8_t* out, int n) {
+    const __m128 f = _mm_set1_ps(factor);
+    const __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128 x[4];
+        load16_ps_sse2(a + i, x);
+        for (int k = 0; k < 4; ++k) {
+            x[k] = _mm_add_ps(_mm_mul_ps(f, x[k]), half);
+        }
+        store16_round_clamp_sse2(out + i, x);
+    }
+    scale_scalar(a + i, factor, out + i, n - i);
+}
+
+CLEARVISION_TARGET("sse2")
+static void blend_sse2(const uint8_t* a, const uint8_t* b, float alpha, uint8_t* out, int n) {
+    const __m128 wa = _mm_set1_ps(alpha);
+    const __m128 wb = _mm_set1_ps(1.0f - alpha);
+    const __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128 x[4], y[4];
+        load16_ps_sse2(a + i, x);
+        load16_ps_sse2(b + i, y);
+        for (int k = 0; k < 4; ++k) {
+            x[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wa, x[k]), _mm_mul_ps(wb, y[k])), half);
+        }
+        store16_round_clamp_sse2(out + i, x);
+    }
+    blend_scalar(a + i, b + i, alpha, out + i, n - i);
+}
+
+// AVX2: 32 pixels or 4 doubles per instruction
+
+CLEARVISION_TARGET("avx2")
+static void add_saturate_avx2(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_adds_epu8(x, y));
+    }
+    add_saturate_sse2(a + i, b + i, out + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void subtract_saturate_avx2(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_subs_epu8(x, y));
+    }
+    subtract_saturate_sse2(a + i, b + i, out + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static bool equal_avx2(const uint8_t* a, const uint8_t* b, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1) {
+            return false;
+        }
+    }
+    return equal_sse2(a + i, b + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void difference_row_avx2(const uint8_t* a, const uint8_t* b, int n, PixelKernels::RowDifference& stats) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i max_difference = zero;
+    __m256i squares = zero;
+    stats.squared_sum = 0;
+    stats.differing = 0;
+    stats.first = stats.last = -1;
+    int i = 0;
+    for (int block = 1; i + 32 <= n; i += 32, ++block) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i d = _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x));
+        max_difference = _mm256_max_epu8(max_difference, d);
+        __m256i lo = _mm256_unpacklo_epi8(d, zero);
+        __m256i hi = _mm256_unpackhi_epi8(d, zero);
+        squares = _mm256_add_epi32(squares, _mm256_add_epi32(_mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+        add_difference_mask(~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(d, zero))), i, stats);
+        if (block % DIFFERENCE_FLUSH_BLOCKS == 0) {
+            stats.squared_sum += sum_epi32_sse2(_mm_add_epi32(_mm256_castsi256_si128(squares),
+                                                              _mm256_extracti128_si256(squares, 1)));
+            squares = zero;
+        }
+    }
+    stats.squared_sum += sum_epi32_sse2(_mm_add_epi32(_mm256_castsi256_si128(squares),
+                                                      _mm256_extracti128_si256(squares, 1)));
+    uint8_t lanes[32];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), max_difference);
+    stats.max_difference = 0;
+    for (int k = 0; k < 32; ++k) {
+        stats.max_difference = lanes[k] > stats.max_difference ? lanes[k] : stats.max_difference;
+    }
+
+    PixelKernels::RowDifference tail;
+    difference_row_sse2(a + i, b + i, n - i, tail);
+    merge_difference_tail(stats, tail, i);
+}
+
+template <int Taps>
+CLEARVISION_TARGET("avx2")
+static void convolve_row_avx2_taps(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    taps = tap_count<Taps>(taps);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d sum_lo = _mm256_loadu_pd(out + i);
+        __m256d sum_hi = _mm256_loadu_pd(out + i + 4);
+        for (int t = 0; t < taps; ++t) {
+            __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(padded + i + t)));
+            __m256d w = _mm256_set1_pd(weights[t]);
+            sum_lo = _mm256_add_pd(sum_lo, _mm256_mul_pd(w, _mm256_cvtepi32_pd(_mm256_castsi256_si128(x))));
+            sum_hi = _mm256_add_pd(sum_hi, _mm256_mul_pd(w, _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1))));
+        }
+        _mm256_storeu_pd(out + i, sum_lo);
+        _mm256_storeu_pd(out + i + 4, sum_hi);
+    }
+    convolve_row_sse2_taps<Taps>(padded + i, weights, taps, out + i, n - i);
+}
+
+template <int Taps>
+CLEARVISION_TARGET("avx2")
+static void convolve_column_avx2_taps(const double* const* rows, const double* weights, int taps, double* out, int n) {
+    taps = tap_count<Taps>(taps);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d sum_lo = _mm256_setzero_pd();
+        __m256d sum_hi = _mm256_setzero_pd();
+        for (int t = 0; t < taps; ++t) {
+            __m256d w = _mm256_set1_pd(weights[t]);
+            sum_lo = _mm256_add_pd(sum_lo, _mm256_mul_pd(w, _mm256_loadu_pd(rows[t] + i)));
+            sum_hi = _mm256_add_pd(sum_hi, _mm256_mul_pd(w, _mm256_loadu_pd(rows[t] + i + 4)));
+        }
+        _mm256_storeu_pd(out + i, sum_lo);
+        _mm256_storeu_pd(out + i + 4, sum_hi);
+    }
+    convolve_column_sse2_from<Taps>(rows, weights, taps, out, i, n);
+}
+
+static void convolve_column_avx2(const double* const* rows, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_avx2_taps, taps, rows, weights, taps, out, n)
+}
+
+// Clamps four doubles to [0, 255] and rounds them down to four 32-bit integers
+CLEARVISION_TARGET("avx2")
+static inline __m128i floor_clamp_pd_avx2(__m256d x) {
+    return _mm256_cvttpd_epi32(_mm256_min_pd(_mm256_max_pd(x, _mm256_setzero_pd()), _mm256_set1_pd(255.0)));
+}
+
+CLEARVISION_TARGET("avx2")
+static void floor_row_avx2(const double* in, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = floor_clamp_pd_avx2(_mm256_loadu_pd(in + i));
+        __m128i b = floor_clamp_pd_avx2(_mm256_loadu_pd(in + i + 4));
+        __m128i words = _mm_packus_epi32(a, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+    }
+    floor_row_sse2(in + i, out + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void unsharp_row_avx2(const uint8_t* original, const double* blurred, double amount, uint8_t* out, int n) {
+    const __m256d a = _mm256_set1_pd(amount);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(original + i)));
+        __m128i x_lo = _mm256_castsi256_si128(x);
+        __m128i x_hi = _mm256_extracti128_si256(x, 1);
+        __m128i d_lo = _mm_sub_epi32(x_lo, floor_clamp_pd_avx2(_mm256_loadu_pd(blurred + i)));
+        __m128i d_hi = _mm_sub_epi32(x_hi, floor_clamp_pd_avx2(_mm256_loadu_pd(blurred + i + 4)));
+        __m256d lo = _mm256_add_pd(_mm256_cvtepi32_pd(x_lo), _mm256_mul_pd(a, _mm256_cvtepi32_pd(d_lo)));
+        __m256d hi = _mm256_add_pd(_mm256_cvtepi32_pd(x_hi), _mm256_mul_pd(a, _mm256_cvtepi32_pd(d_hi)));
+        __m128i words = _mm_packus_epi32(floor_clamp_pd_avx2(lo), floor_clamp_pd_avx2(hi));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(words, words));
+    }
+    unsharp_row_sse2(original + i, blurred + i, amount, out + i, n - i);
+}
+
+// 16 outputs per iteration. The 256-bit unpacks work within each 128-bit lane, so the low
+// half holds outputs 0-3 and 8-11 and the high half 4-7 and 12-15; packing them back together
+// per lane restores the order.
+template <int Taps>
+CLEARVISION_TARGET("avx2")
+static void convolve_row_fixed_avx2_taps(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    taps = tap_count<Taps>(taps);
+    const __m256i rounding = _mm256_set1_epi32(1 << (FIXED_ROW_SHIFT - 1));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i sum_lo = rounding;
+        __m256i sum_hi = rounding;
+        for (int t = 0; t < taps; t += 2) {
+            __m256i w = _mm256_set1_epi32(weight_pair(weights, t, taps));
+            __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(padded + i + t)));
+            __m256i b = t + 1 < taps
+                    ? _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(padded + i + t + 1)))
+                    : _mm256_setzero_si256();
+            sum_lo = _mm256_add_epi32(sum_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            sum_hi = _mm256_add_epi32(sum_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(sum_lo, FIXED_ROW_SHIFT),
+                                           _mm256_srai_epi32(sum_hi, FIXED_ROW_SHIFT));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), words);
+    }
+    convolve_row_fixed_sse2_taps<Taps>(padded + i, weights, taps, out + i, n - i);
+}
+
+template <int Taps>
+CLEARVISION_TARGET("avx2")
+static void convolve_column_fixed_avx2_taps(const int16_t* const* rows, const int16_t* weights, int taps,
+                                       uint8_t* out, int n) {
+    taps = tap_count<Taps>(taps);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i sum_lo = _mm256_setzero_si256();
+        __m256i sum_hi = _mm256_setzero_si256();
+        for (int t = 0; t < taps; t += 2) {
+            __m256i w = _mm256_set1_epi32(weight_pair(weights, t, taps));
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[t] + i));
+            __m256i b = t + 1 < taps ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[t + 1] + i))
+                                     : _mm256_setzero_si256();
+            sum_lo = _mm256_add_epi32(sum_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+            sum_hi = _mm256_add_epi32(sum_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+        }
+        __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(sum_lo, FIXED_COLUMN_SHIFT),
+                                           _mm256_srai_epi32(sum_hi, FIXED_COLUMN_SHIFT));
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bytes);
+    }
+    convolve_column_fixed_sse2_from<Taps>(rows, weights, taps, out, i, n);
+}
+
+static void convolve_row_avx2(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_avx2_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_row_fixed_avx2(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_fixed_avx2_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_column_fixed_avx2(const int16_t* const* rows, const int16_t* weights, int taps,
+                                       uint8_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_fixed_avx2_taps, taps, rows, weights, taps, out, n)
+}
+
+CLEARVISION_TARGET("avx2")
+static void extract_lsb_avx2(const uint8_t* pixels, int* bits, int n) {
+    const __m256i one = _mm256_set1_epi32(1);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(bits + i), _mm256_and_si256(x, one));
+    }
+    extract_lsb_scalar(pixels + i, bits + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void embed_lsb_avx2(uint8_t* pixels, const int* bits, int n) {
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m128i keep = _mm_set1_epi8(static_cast<char>(0xFE));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i* source = reinterpret_cast<const __m256i*>(bits + i);
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256(source), one);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256(source + 1), one);
+        // packs works within 128-bit lanes; the permute puts the 16 words back in order
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        __m128i lsb = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        __m128i* target = reinterpret_cast<__m128i*>(pixels + i);
+        _mm_storeu_si128(target, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(target), keep), lsb));
+    }
+    embed_lsb_scalar(pixels + i, bits + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void add_scalar_saturate_avx2(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    const __m256i y = _mm256_set1_epi8(static_cast<char>(value));
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_adds_epu8(x, y));
+    }
+    add_scalar_saturate_sse2(a + i, value, out + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void subtract_scalar_saturate_avx2(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    const __m256i y = _mm256_set1_epi8(static_cast<char>(value));
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_subs_epu8(x, y));
+    }
+    subtract_scalar_saturate_sse2(a + i, value, out + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void absolute_difference_avx2(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                            _mm256_or_si256(_mm256_subs_epu8(x, y), _mm256_subs_epu8(y, x)));
+    }
+    absolute_difference_sse2(a + i, b + i, out + i, n - i);
+}
+
+// Sixteen pixels widened to two vectors of eight floats
+CLEARVISION_TARGET("avx2")
+static inline void load16_ps_avx2(const uint8_t* p, __m256 values[2]) {
+    values[0] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+    values[1] = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 8))));
+}
+
+// round_clamp on two vectors of eight floats, packed into sixteen pixels
+CLEARVISION_TARGET("avx2")
+static inline void store16_round_clamp_avx2(uint8_t* p, const __m256 values[2]) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max_value = _mm256_set1_ps(255.0f);
+    __m256i a = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(values[0], zero), max_value));
+    __m256i b = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(values[1], zero), max_value));
+    // packs works within 128-bit lanes; the permute puts the 16 words back in order
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+    __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), packed);
+}
+
+CLEARVISION_TARGET("avx2")
+static void scale_avx2(const uint8_t* a, float factor, uint8_t* out, int n) {
+    const __m256 f = _mm256_set1_ps(factor);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 x[2];
+        load16_ps_avx2(a + i, x);
+        for (int k = 0; k < 2; ++k) {
+            x[k] = _mm256_add_ps(_mm256_mul_ps(f, x[k]), half);
+        }
+        store16_round_clamp_avx2(out + i, x);
+    }
+    scale_sse2(a + i, factor, out + i, n - i);
+}
+
+CLEARVISION_TARGET("avx2")
+static void blend_avx2(const uint8_t* a, const uint8_t* b, float alpha, uint8_t* out, int n) {
+    const __m256 wa = _mm256_set1_ps(alpha);
+    const __m256 wb = _mm256_set1_ps(1.0f - alpha);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 x[2], y[2];
+        load16_ps_avx2(a + i, x);
+        load16_ps_avx2(b + i, y);
+        for (int k = 0; k < 2; ++k) {
+            x[k] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(wa, x[k]), _mm256_mul_ps(wb, y[k])), half);
+        }
+        store16_round_clamp_avx2(out + i, x);
+    }
+    blend_sse2(a + i, b + i, alpha, out + i, n - i);
+}
+
+// AVX-512 (F + BW): 64 pixels or 8 doubles per instruction, tails handled with masked
+// loads and stores. AVX-512 implies FMA, so the compiler may fuse a plain multiply and
+// add; the explicitly rounded forms are never fused.
+
+// GCC 12's AVX-512 headers trip -Wmaybe-uninitialized on their own placeholder operands.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#define CLEARVISION_MUL_PD(a, b) _mm512_mul_round_pd((a), (b), _MM_FROUND_CUR_DIRECTION)
+#define CLEARVISION_ADD_PD(a, b) _mm512_add_round_pd((a), (b), _MM_FROUND_CUR_DIRECTION)
+#define CLEARVISION_MUL_PS(a, b) _mm512_mul_round_ps((a), (b), _MM_FROUND_CUR_DIRECTION)
+#define CLEARVISION_ADD_PS(a, b) _mm512_add_round_ps((a), (b), _MM_FROUND_CUR_DIRECTION)
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void add_saturate_avx512(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        _mm512_storeu_si512(out + i, _mm512_adds_epu8(x, y));
+    }
+    if (i < n) {
+        __mmask64 tail = _cvtu64_mask64((~0ULL) >> (64 - (n - i)));
+        __m512i x = _mm512_maskz_loadu_epi8(tail, a + i);
+        __m512i y = _mm512_maskz_loadu_epi8(tail, b + i);
+        _mm512_mask_storeu_epi8(out + i, tail, _mm512_adds_epu8(x, y));
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void subtract_saturate_avx512(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        _mm512_storeu_si512(out + i, _mm512_subs_epu8(x, y));
+    }
+    if (i < n) {
+        __mmask64 tail = _cvtu64_mask64((~0ULL) >> (64 - (n - i)));
+        __m512i x = _mm512_maskz_loadu_epi8(tail, a + i);
+        __m512i y = _mm512_maskz_loadu_epi8(tail, b + i);
+        _mm512_mask_storeu_epi8(out + i, tail, _mm512_subs_epu8(x, y));
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static bool equal_avx512(const uint8_t* a, const uint8_t* b, int n) {
+    int i = 0;
+    for (; i + 64 <= n; i += 64) {
+        if (_mm512_cmpneq_epu8_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)) != 0) {
+            return false;
+        }
+    }
+    if (i < n) {
+        __mmask64 tail = _cvtu64_mask64((~0ULL) >> (64 - (n - i)));
+        __m512i x = _mm512_maskz_loadu_epi8(tail, a + i);
+        __m512i y = _mm512_maskz_loadu_epi8(tail, b + i);
+        return _mm512_cmpneq_epu8_mask(x, y) == 0;
+    }
+    return true;
+}
+
+CLEARVISION_TARGET("avx512f")
+static inline uint64_t sum_epi32_avx512(__m512i x) {
+    uint32_t lanes[16];
+    _mm512_storeu_si512(lanes, x);
+    uint64_t sum = 0;
+    for (int k = 0; k < 16; ++k) {
+        sum += lanes[k];
+    }
+    return sum;
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void difference_row_avx512(const uint8_t* a, const uint8_t* b, int n, PixelKernels::RowDifference& stats) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i max_difference = zero;
+    __m512i squares = zero;
+    stats.squared_sum = 0;
+    stats.differing = 0;
+    stats.first = stats.last = -1;
+    for (int i = 0, block = 1; i < n; i += 64, ++block) {
+        // Masked-off lanes load as zero in both rows, so they never count as a difference.
+        __mmask64 lanes = _cvtu64_mask64(n - i >= 64 ? ~0ULL : (~0ULL) >> (64 - (n - i)));
+        __m512i x = _mm512_maskz_loadu_epi8(lanes, a + i);
+        __m512i y = _mm512_maskz_loadu_epi8(lanes, b + i);
+        __m512i d = _mm512_or_si512(_mm512_subs_epu8(x, y), _mm512_subs_epu8(y, x));
+        max_difference = _mm512_max_epu8(max_difference, d);
+        __m512i lo = _mm512_unpacklo_epi8(d, zero);
+        __m512i hi = _mm512_unpackhi_epi8(d, zero);
+        squares = _mm512_add_epi32(squares, _mm512_add_epi32(_mm512_madd_epi16(lo, lo), _mm512_madd_epi16(hi, hi)));
+        add_difference_mask(_cvtmask64_u64(_mm512_test_epi8_mask(d, d)), i, stats);
+        if (block % DIFFERENCE_FLUSH_BLOCKS == 0) {
+            stats.squared_sum += sum_epi32_avx512(squares);
+            squares = zero;
+        }
+    }
+    stats.squared_sum += sum_epi32_avx512(squares);
+    uint8_t maxima[64];
+    _mm512_storeu_si512(maxima, max_difference);
+    stats.max_difference = 0;
+    for (int k = 0; k < 64; ++k) {
+        stats.max_difference = maxima[k] > stats.max_difference ? maxima[k] : stats.max_difference;
+    }
+}
+
+// Sixteen pixels (the first count of them, the rest zero) widened to 32-bit integers
+CLEARVISION_TARGET("avx512f,avx512bw")
+static inline __m512i load16_epu8_avx512(const uint8_t* p, int count) {
+    if (count >= 16) {
+        return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+    __mmask64 lanes = _cvtu64_mask64((1ULL << count) - 1);
+    return _mm512_cvtepu8_epi32(_mm512_castsi512_si128(_mm512_maskz_loadu_epi8(lanes, p)));
+}
+
+template <int Taps>
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void convolve_row_avx512_taps(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    taps = tap_count<Taps>(taps);
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        const __mmask8 lo_lanes = static_cast<__mmask8>(count >= 8 ? 0xFF : (1 << count) - 1);
+        const __mmask8 hi_lanes = static_cast<__mmask8>(count >= 16 ? 0xFF : count <= 8 ? 0 : (1 << (count - 8)) - 1);
+        __m512d sum_lo = _mm512_maskz_loadu_pd(lo_lanes, out + i);
+        __m512d sum_hi = _mm512_maskz_loadu_pd(hi_lanes, out + i + 8);
+        for (int t = 0; t < taps; ++t) {
+            __m512i x = load16_epu8_avx512(padded + i + t, count);
+            __m512d w = _mm512_set1_pd(weights[t]);
+            sum_lo = CLEARVISION_ADD_PD(sum_lo, CLEARVISION_MUL_PD(w, _mm512_cvtepi32_pd(_mm512_castsi512_si256(x))));
+            sum_hi = CLEARVISION_ADD_PD(sum_hi, CLEARVISION_MUL_PD(w, _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(x, 1))));
+        }
+        _mm512_mask_storeu_pd(out + i, lo_lanes, sum_lo);
+        _mm512_mask_storeu_pd(out + i + 8, hi_lanes, sum_hi);
+    }
+}
+
+template <int Taps>
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void convolve_column_avx512_taps(const double* const* rows, const double* weights, int taps, double* out,
+                                        int n) {
+    taps = tap_count<Taps>(taps);
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        const __mmask8 lo_lanes = static_cast<__mmask8>(count >= 8 ? 0xFF : (1 << count) - 1);
+        const __mmask8 hi_lanes = static_cast<__mmask8>(count >= 16 ? 0xFF : count <= 8 ? 0 : (1 << (count - 8)) - 1);
+        __m512d sum_lo = _mm512_setzero_pd();
+        __m512d sum_hi = _mm512_setzero_pd();
+        for (int t = 0; t < taps; ++t) {
+            __m512d w = _mm512_set1_pd(weights[t]);
+            sum_lo = CLEARVISION_ADD_PD(sum_lo, CLEARVISION_MUL_PD(w, _mm512_maskz_loadu_pd(lo_lanes, rows[t] + i)));
+            sum_hi = CLEARVISION_ADD_PD(sum_hi, CLEARVISION_MUL_PD(w, _mm512_maskz_loadu_pd(hi_lanes, rows[t] + i + 8)));
+        }
+        _mm512_mask_storeu_pd(out + i, lo_lanes, sum_lo);
+        _mm512_mask_storeu_pd(out + i + 8, hi_lanes, sum_hi);
+    }
+}
+
+static void convolve_column_avx512(const double* const* rows, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_avx512_taps, taps, rows, weights, taps, out, n)
+}
+
+// Clamps eight doubles to [0, 255] and rounds them down to eight 32-bit integers
+CLEARVISION_TARGET("avx512f,avx512bw")
+static inline __m256i floor_clamp_pd_avx512(__m512d x) {
+    return _mm512_cvttpd_epi32(_mm512_min_pd(_mm512_max_pd(x, _mm512_setzero_pd()), _mm512_set1_pd(255.0)));
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void floor_row_avx512(const double* in, uint8_t* out, int n) {
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        const __mmask8 lo_lanes = static_cast<__mmask8>(count >= 8 ? 0xFF : (1 << count) - 1);
+        const __mmask8 hi_lanes = static_cast<__mmask8>(count >= 16 ? 0xFF : count <= 8 ? 0 : (1 << (count - 8)) - 1);
+        __m256i lo = floor_clamp_pd_avx512(_mm512_maskz_loadu_pd(lo_lanes, in + i));
+        __m256i hi = floor_clamp_pd_avx512(_mm512_maskz_loadu_pd(hi_lanes, in + i + 8));
+        __m512i values = _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+        _mm512_mask_cvtepi32_storeu_epi8(out + i, static_cast<__mmask16>((1u << count) - 1), values);
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void unsharp_row_avx512(const uint8_t* original, const double* blurred, double amount, uint8_t* out, int n) {
+    const __m512d a = _mm512_set1_pd(amount);
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        const __mmask8 lo_lanes = static_cast<__mmask8>(count >= 8 ? 0xFF : (1 << count) - 1);
+        const __mmask8 hi_lanes = static_cast<__mmask8>(count >= 16 ? 0xFF : count <= 8 ? 0 : (1 << (count - 8)) - 1);
+        __m512i x = load16_epu8_avx512(original + i, count);
+        __m256i x_lo = _mm512_castsi512_si256(x);
+        __m256i x_hi = _mm512_extracti64x4_epi64(x, 1);
+        __m256i d_lo = _mm256_sub_epi32(x_lo, floor_clamp_pd_avx512(_mm512_maskz_loadu_pd(lo_lanes, blurred + i)));
+        __m256i d_hi = _mm256_sub_epi32(x_hi, floor_clamp_pd_avx512(_mm512_maskz_loadu_pd(hi_lanes, blurred + i + 8)));
+        __m512d lo = CLEARVISION_ADD_PD(_mm512_cvtepi32_pd(x_lo), CLEARVISION_MUL_PD(a, _mm512_cvtepi32_pd(d_lo)));
+        __m512d hi = CLEARVISION_ADD_PD(_mm512_cvtepi32_pd(x_hi), CLEARVISION_MUL_PD(a, _mm512_cvtepi32_pd(d_hi)));
+        __m512i values = _mm512_inserti64x4(_mm512_castsi256_si512(floor_clamp_pd_avx512(lo)), floor_clamp_pd_avx512(hi), 1);
+        _mm512_mask_cvtepi32_storeu_epi8(out + i, static_cast<__mmask16>((1u << count) - 1), values);
+    }
+}
+
+// 32 pixels (the first count of them, the rest zero) widened to 16-bit integers
+CLEARVISION_TARGET("avx512f,avx512bw")
+static inline __m512i load32_epu8_avx512(const uint8_t* p, int count) {
+    if (count >= 32) {
+        return _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    }
+    __mmask64 lanes = _cvtu64_mask64((1ULL << count) - 1);
+    return _mm512_cvtepu8_epi16(_mm512_castsi512_si256(_mm512_maskz_loadu_epi8(lanes, p)));
+}
+
+template <int Taps>
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void convolve_row_fixed_avx512_taps(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    taps = tap_count<Taps>(taps);
+    const __m512i rounding = _mm512_set1_epi32(1 << (FIXED_ROW_SHIFT - 1));
+    for (int i = 0; i < n; i += 32) {
+        const int count = n - i < 32 ? n - i : 32;
+        __m512i sum_lo = rounding;
+        __m512i sum_hi = rounding;
+        for (int t = 0; t < taps; t += 2) {
+            __m512i w = _mm512_set1_epi32(weight_pair(weights, t, taps));
+            __m512i a = load32_epu8_avx512(padded + i + t, count);
+            __m512i b = t + 1 < taps ? load32_epu8_avx512(padded + i + t + 1, count) : _mm512_setzero_si512();
+            sum_lo = _mm512_add_epi32(sum_lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(a, b), w));
+            sum_hi = _mm512_add_epi32(sum_hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(a, b), w));
+        }
+        __m512i words = _mm512_packs_epi32(_mm512_srai_epi32(sum_lo, FIXED_ROW_SHIFT),
+                                           _mm512_srai_epi32(sum_hi, FIXED_ROW_SHIFT));
+        _mm512_mask_storeu_epi16(out + i, static_cast<__mmask32>(count >= 32 ? ~0u : (1u << count) - 1), words);
+    }
+}
+
+template <int Taps>
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void convolve_column_fixed_avx512_taps(const int16_t* const* rows, const int16_t* weights, int taps,
+                                         uint8_t* out, int n) {
+    taps = tap_count<Taps>(taps);
+    for (int i = 0; i < n; i += 32) {
+        const int count = n - i < 32 ? n - i : 32;
+        const __mmask32 lanes = static_cast<__mmask32>(count >= 32 ? ~0u : (1u << count) - 1);
+        __m512i sum_lo = _mm512_setzero_si512();
+        __m512i sum_hi = _mm512_setzero_si512();
+        for (int t = 0; t < taps; t += 2) {
+            __m512i w = _mm512_set1_epi32(weight_pair(weights, t, taps));
+            __m512i a = _mm512_maskz_loadu_epi16(lanes, rows[t] + i);
+            __m512i b = t + 1 < taps ? _mm512_maskz_loadu_epi16(lanes, rows[t + 1] + i) : _mm512_setzero_si512();
+            sum_lo = _mm512_add_epi32(sum_lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(a, b), w));
+            sum_hi = _mm512_add_epi32(sum_hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(a, b), w));
+        }
+        __m512i words = _mm512_packs_epi32(_mm512_srai_epi32(sum_lo, FIXED_COLUMN_SHIFT),
+                                           _mm512_srai_epi32(sum_hi, FIXED_COLUMN_SHIFT));
+        words = _mm512_max_epi16(words, _mm512_setzero_si512());
+        _mm512_mask_cvtusepi16_storeu_epi8(out + i, lanes, words);
+    }
+}
+
+static void convolve_row_avx512(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_avx512_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_row_fixed_avx512(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_row_fixed_avx512_taps, taps, padded, weights, taps, out, n)
+}
+
+static void convolve_column_fixed_avx512(const int16_t* const* rows, const int16_t* weights, int taps,
+                                         uint8_t* out, int n) {
+    CLEARVISION_DISPATCH_TAPS(convolve_column_fixed_avx512_taps, taps, rows, weights, taps, out, n)
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void extract_lsb_avx512(const uint8_t* pixels, int* bits, int n) {
+    const __m512i one = _mm512_set1_epi32(1);
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        __m512i x = _mm512_and_si512(load16_epu8_avx512(pixels + i, count), one);
+        _mm512_mask_storeu_epi32(bits + i, static_cast<__mmask16>((1u << count) - 1), x);
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void embed_lsb_avx512(uint8_t* pixels, const int* bits, int n) {
+    const __m512i one = _mm512_set1_epi32(1);
+    const __m512i keep = _mm512_set1_epi32(0xFE);
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        const __mmask16 lanes = static_cast<__mmask16>((1u << count) - 1);
+        __m512i lsb = _mm512_and_si512(_mm512_maskz_loadu_epi32(lanes, bits + i), one);
+        __m512i x = _mm512_and_si512(load16_epu8_avx512(pixels + i, count), keep);
+        _mm512_mask_cvtepi32_storeu_epi8(pixels + i, lanes, _mm512_or_si512(x, lsb));
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void add_scalar_saturate_avx512(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    const __m512i y = _mm512_set1_epi8(static_cast<char>(value));
+    for (int i = 0; i < n; i += 64) {
+        __mmask64 lanes = _cvtu64_mask64(n - i >= 64 ? ~0ULL : (~0ULL) >> (64 - (n - i)));
+        __m512i x = _mm512_maskz_loadu_epi8(lanes, a + i);
+        _mm512_mask_storeu_epi8(out + i, lanes, _mm512_adds_epu8(x, y));
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void subtract_scalar_saturate_avx512(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    const __m512i y = _mm512_set1_epi8(static_cast<char>(value));
+    for (int i = 0; i < n; i += 64) {
+        __mmask64 lanes = _cvtu64_mask64(n - i >= 64 ? ~0ULL : (~0ULL) >> (64 - (n - i)));
+        __m512i x = _mm512_maskz_loadu_epi8(lanes, a + i);
+        _mm512_mask_storeu_epi8(out + i, lanes, _mm512_subs_epu8(x, y));
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void absolute_difference_avx512(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    for (int i = 0; i < n; i += 64) {
+        __mmask64 lanes = _cvtu64_mask64(n - i >= 64 ? ~0ULL : (~0ULL) >> (64 - (n - i)));
+        __m512i x = _mm512_maskz_loadu_epi8(lanes, a + i);
+        __m512i y = _mm512_maskz_loadu_epi8(lanes, b + i);
+        _mm512_mask_storeu_epi8(out + i, lanes, _mm512_or_si512(_mm512_subs_epu8(x, y), _mm512_subs_epu8(y, x)));
+    }
+}
+
+// round_clamp on sixteen floats, stored as the first count pixels at p
+CLEARVISION_TARGET("avx512f,avx512bw")
+static inline void store16_round_clamp_avx512(uint8_t* p, __m512 values, int count) {
+    values = _mm512_min_ps(_mm512_max_ps(values, _mm512_setzero_ps()), _mm512_set1_ps(255.0f));
+    _mm512_mask_cvtepi32_storeu_epi8(p, static_cast<__mmask16>((1u << count) - 1), _mm512_cvttps_epi32(values));
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void scale_avx512(const uint8_t* a, float factor, uint8_t* out, int n) {
+    const __m512 f = _mm512_set1_ps(factor);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        __m512 x = _mm512_cvtepi32_ps(load16_epu8_avx512(a + i, count));
+        x = CLEARVISION_ADD_PS(CLEARVISION_MUL_PS(f, x), half);
+        store16_round_clamp_avx512(out + i, x, count);
+    }
+}
+
+CLEARVISION_TARGET("avx512f,avx512bw")
+static void blend_avx512(const uint8_t* a, const uint8_t* b, float alpha, uint8_t* out, int n) {
+    const __m512 wa = _mm512_set1_ps(alpha);
+    const __m512 wb = _mm512_set1_ps(1.0f - alpha);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    for (int i = 0; i < n; i += 16) {
+        const int count = n - i < 16 ? n - i : 16;
+        __m512 x = _mm512_cvtepi32_ps(load16_epu8_avx512(a + i, count));
+        __m512 y = _mm512_cvtepi32_ps(load16_epu8_avx512(b + i, count));
+        __m512 sum = CLEARVISION_ADD_PS(CLEARVISION_MUL_PS(wa, x), CLEARVISION_MUL_PS(wb, y));
+        store16_round_clamp_avx512(out + i, CLEARVISION_ADD_PS(sum, half), count);
+    }
+}
+
+#undef CLEARVISION_MUL_PD
+#undef CLEARVISION_ADD_PD
+#undef CLEARVISION_MUL_PS
+#undef CLEARVISION_ADD_PS
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // CLEARVISION_X86
+
+// Dispatch table: one set of kernels per instruction set level
+
+struct KernelSet {
+    CpuFeatures::Level level;
+    void (*add_saturate)(const uint8_t*, const uint8_t*, uint8_t*, int);
+    void (*subtract_saturate)(const uint8_t*, const uint8_t*, uint8_t*, int);
+    bool (*equal)(const uint8_t*, const uint8_t*, int);
+    void (*convolve_row)(const uint8_t*, const double*, int, double*, int);
+    void (*convolve_column)(const double* const*, const double*, int, double*, int);
+    void (*floor_row)(const double*, uint8_t*, int);
+    void (*extract_lsb)(const uint8_t*, int*, int);
+    void (*embed_lsb)(uint8_t*, const int*, int);
+    void (*add_scalar_saturate)(const uint8_t*, uint8_t, uint8_t*, int);
+    void (*subtract_scalar_saturate)(const uint8_t*, uint8_t, uint8_t*, int);
+    void (*absolute_difference)(const uint8_t*, const uint8_t*, uint8_t*, int);
+    void (*scale)(const uint8_t*, float, uint8_t*, int);
+    void (*blend)(const uint8_t*, const uint8_t*, float, uint8_t*, int);
+    void (*difference_row)(const uint8_t*, const uint8_t*, int, PixelKernels::RowDifference&);
+    void (*unsharp_row)(const uint8_t*, const double*, double, uint8_t*, int);
+    void (*convolve_row_fixed)(const uint8_t*, const int16_t*, int, int16_t*, int);
+    void (*convolve_column_fixed)(const int16_t* const*, const int16_t*, int, uint8_t*, int);
+};
+
+static const KernelSet scalar_kernels = {
+    CpuFeatures::LEVEL_SCALAR, add_saturate_scalar, subtract_saturate_scalar, equal_scalar,
+    convolve_row_scalar, convolve_column_scalar, floor_row_scalar, extract_lsb_scalar, embed_lsb_scalar,
+    add_scalar_saturate_scalar, subtract_scalar_saturate_scalar, absolute_difference_scalar, scale_scalar, blend_scalar,
+    difference_row_scalar, unsharp_row_scalar, convolve_row_fixed_scalar, convolve_column_fixed_scalar
+};
+
+#ifdef CLEARVISION_X86
+static const KernelSet sse2_kernels = {
+    CpuFeatures::LEVEL_SSE2, add_saturate_sse2, subtract_saturate_sse2, equal_sse2,
+    convolve_row_sse2, convolve_column_sse2, floor_row_sse2, extract_lsb_sse2, embed_lsb_sse2,
+    add_scalar_saturate_sse2, subtract_scalar_saturate_sse2, absolute_difference_sse2, scale_sse2, blend_sse2,
+    difference_row_sse2, unsharp_row_sse2, convolve_row_fixed_sse2, convolve_column_fixed_sse2
+};
+
+static const KernelSet avx2_kernels = {
+    CpuFeatures::LEVEL_AVX2, add_saturate_avx2, subtract_saturate_avx2, equal_avx2,
+    convolve_row_avx2, convolve_column_avx2, floor_row_avx2, extract_lsb_avx2, embed_lsb_avx2,
+    add_scalar_saturate_avx2, subtract_scalar_saturate_avx2, absolute_difference_avx2, scale_avx2, blend_avx2,
+    difference_row_avx2, unsharp_row_avx2, convolve_row_fixed_avx2, convolve_column_fixed_avx2
+};
+
+static const KernelSet avx512_kernels = {
+    CpuFeatures::LEVEL_AVX512, add_saturate_avx512, subtract_saturate_avx512, equal_avx512,
+    convolve_row_avx512, convolve_column_avx512, floor_row_avx512, extract_lsb_avx512, embed_lsb_avx512,
+    add_scalar_saturate_avx512, subtract_scalar_saturate_avx512, absolute_difference_avx512, scale_avx512, blend_avx512,
+    difference_row_avx512, unsharp_row_avx512, convolve_row_fixed_avx512, convolve_column_fixed_avx512
+};
+#endif
+
+// Widest kernel set at or below the given level
+static const KernelSet* kernels_for(CpuFeatures::Level level) {
+    if (level > CpuFeatures::get_supported_level()) {
+        level = CpuFeatures::get_supported_level();
+    }
+#ifdef CLEARVISION_X86
+    switch (level) {
+        case CpuFeatures::LEVEL_AVX512:
+            return &avx512_kernels;
+        case CpuFeatures::LEVEL_AVX2:
+            return &avx2_kernels;
+        case CpuFeatures::LEVEL_SSE2:
+            return &sse2_kernels;
+        default:
+            break;
+    }
+#endif
+    return &scalar_kernels;
+}
+
+// The bound set, chosen on first use from CpuFeatures::get_startup_level
+static std::atomic<const KernelSet*>& bound_kernels() {
+    static std::atomic<const KernelSet*> bound(kernels_for(CpuFeatures::get_startup_level()));
+    return bound;
+}
+
+static const KernelSet& kernels() {
+    return *bound_kernels().load(std::memory_order_relaxed);
+}
+
+void PixelKernels::add_saturate(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    kernels().add_saturate(a, b, out, n);
+}
+
+void PixelKernels::subtract_saturate(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    kernels().subtract_saturate(a, b, out, n);
+}
+
+bool PixelKernels::equal(const uint8_t* a, const uint8_t* b, int n) {
+    return kernels().equal(a, b, n);
+}
+
+void PixelKernels::difference_row(const uint8_t* a, const uint8_t* b, int n, RowDifference& stats) {
+    kernels().difference_row(a, b, n, stats);
+}
+
+void PixelKernels::convolve_row(const uint8_t* padded, const double* weights, int taps, double* out, int n) {
+    kernels().convolve_row(padded, weights, taps, out, n);
+}
+
+void PixelKernels::convolve_column(const double* const* rows, const double* weights, int taps, double* out, int n) {
+    kernels().convolve_column(rows, weights, taps, out, n);
+}
+
+void PixelKernels::floor_row(const double* in, uint8_t* out, int n) {
+    kernels().floor_row(in, out, n);
+}
+
+void PixelKernels::unsharp_row(const uint8_t* original, const double* blurred, double amount, uint8_t* out, int n) {
+    kernels().unsharp_row(original, blurred, amount, out, n);
+}
+
+void PixelKernels::convolve_row_fixed(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n) {
+    kernels().convolve_row_fixed(padded, weights, taps, out, n);
+}
+
+void PixelKernels::convolve_column_fixed(const int16_t* const* rows, const int16_t* weights, int taps,
+                                         uint8_t* out, int n) {
+    kernels().convolve_column_fixed(rows, weights, taps, out, n);
+}
+
+void PixelKernels::extract_lsb(const uint8_t* pixels, int* bits, int n) {
+    kernels().extract_lsb(pixels, bits, n);
+}
+
+void PixelKernels::embed_lsb(uint8_t* pixels, const int* bits, int n) {
+    kernels().embed_lsb(pixels, bits, n);
+}
+
+void PixelKernels::add_scalar_saturate(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    kernels().add_scalar_saturate(a, value, out, n);
+}
+
+void PixelKernels::subtract_scalar_saturate(const uint8_t* a, uint8_t value, uint8_t* out, int n) {
+    kernels().subtract_scalar_saturate(a, value, out, n);
+}
+
+void PixelKernels::absolute_difference(const uint8_t* a, const uint8_t* b, uint8_t* out, int n) {
+    kernels().absolute_difference(a, b, out, n);
+}
+
+void PixelKernels::scale(const uint8_t* a, float factor, uint8_t* out, int n) {
+    kernels().scale(a, factor, out, n);
+}
+
+void PixelKernels::blend(const uint8_t* a, const uint8_t* b, float alpha, uint8_t* out, int n) {
+    kernels().blend(a, b, alpha, out, n);
+}
+
+CpuFeatures::Level PixelKernels::get_level() {
+    return kernels().level;
+}
+
+void PixelKernels::set_level(CpuFeatures::Level level) {
+    bound_kernels().store(kernels_for(level), std::memory_order_relaxed);
+}
+
+const char* PixelKernels::get_isa_name() {
+    return CpuFeatures::get_level_name(get_level());
+}
@@ -0,0 +1,97 @@
+#ifndef PIXEL_KERNELS_H
+#define PIXEL_KERNELS_H
+
+#include <cstdint>
+
+#include "CpuFeatures.h"
+
+// Row kernels shared by the image operations. Each kernel has a portable scalar
+// version and, on x86, SSE2/AVX2/AVX-512 versions. All kernels are bound together
+// to one instruction set level, chosen once at startup by CpuFeatures (and the
+// CLEARVISION_SIMD override). Every level produces bit-identical output. The convolution
+// kernels have unrolled versions for 3, 5 and 7 taps, chosen by the tap count they are given.
+class PixelKernels {
+public:
+    // Difference statistics of one pair of rows, filled in by difference_row
+    struct RowDifference {
+        uint64_t squared_sum;   // Sum of (a[i] - b[i])^2
+        int max_difference;     // Largest |a[i] - b[i]|
+        int differing;          // Number of i with a[i] != b[i]
+        int first, last;        // Lowest and highest such i, -1 if there is none
+    };
+
+    // out[i] = min(a[i] + b[i], 255) for n pixels; out may alias a or b
+    static void add_saturate(const uint8_t* a, const uint8_t* b, uint8_t* out, int n);
+
+    // out[i] = max(a[i] - b[i], 0) for n pixels; out may alias a or b
+    static void subtract_saturate(const uint8_t* a, const uint8_t* b, uint8_t* out, int n);
+
+    // out[i] = min(a[i] + value, 255) and max(a[i] - value, 0) for n pixels; out may alias a
+    static void add_scalar_saturate(const uint8_t* a, uint8_t value, uint8_t* out, int n);
+    static void subtract_scalar_saturate(const uint8_t* a, uint8_t value, uint8_t* out, int n);
+
+    // out[i] = |a[i] - b[i]| for n pixels; out may alias a or b
+    static void absolute_difference(const uint8_t* a, const uint8_t* b, uint8_t* out, int n);
+
+    // out[i] = factor * a[i], and out[i] = alpha * a[i] + (1 - alpha) * b[i], for n pixels.
+    // Computed in single precision without fused multiply-add, rounded half up and clamped to
+    // [0, 255]; factor and alpha must be finite. out may alias a or b.
+    static void scale(const uint8_t* a, float factor, uint8_t* out, int n);
+    static void blend(const uint8_t* a, const uint8_t* b, float alpha, uint8_t* out, int n);
+
+    // True if the n pixels of a and b are the same
+    static bool equal(const uint8_t* a, const uint8_t* b, int n);
+
+    // Compares n pixels of a and b
+    static void difference_row(const uint8_t* a, const uint8_t* b, int n, RowDifference& stats);
+
+    // out[i] = sum over t of weights[t] * padded[i + t], for n outputs and taps weights.
+    // Terms are added in increasing t, each product rounded before the addition (no fused
+    // multiply-add), exactly like the scalar loop.
+    static void convolve_row(const uint8_t* padded, const double* weights, int taps, double* out, int n);
+
+    // Vertical pass over taps rows: out[i] = sum over t of weights[t] * rows[t][i], for n outputs,
+    // added in increasing t from 0 without fusing
+    static void convolve_column(const double* const* rows, const double* weights, int taps, double* out, int n);
+
+    // out[i] = floor(in[i]) clamped to [0, 255], for n values
+    static void floor_row(const double* in, uint8_t* out, int n);
+
+    // Unsharp mask of n pixels: b = floor(blurred[i]) clamped to [0, 255], then
+    // out[i] = floor(original[i] + amount * (original[i] - b)) clamped to [0, 255].
+    // amount must be finite; out may alias original.
+    static void unsharp_row(const uint8_t* original, const double* blurred, double amount, uint8_t* out, int n);
+
+    // Fixed-point separable convolution. Weights are integers in units of 2^-FIXED_WEIGHT_BITS
+    // (the weights of a kernel should add up to 1 << FIXED_WEIGHT_BITS); the horizontal pass keeps
+    // FIXED_ROW_BITS fractional bits in 16-bit intermediates.
+    static const int FIXED_WEIGHT_BITS = 14;
+    static const int FIXED_ROW_BITS = 7;
+
+    // Horizontal pass: out[i] = (sum over t of weights[t] * padded[i + t]) / 2^(FIXED_WEIGHT_BITS -
+    // FIXED_ROW_BITS), rounded half up. Sums are exact in 32 bits.
+    static void convolve_row_fixed(const uint8_t* padded, const int16_t* weights, int taps, int16_t* out, int n);
+
+    // Vertical pass over taps intermediate rows: out[i] = (sum over t of weights[t] * rows[t][i]) /
+    // 2^(FIXED_WEIGHT_BITS + FIXED_ROW_BITS), rounded down and clamped to [0, 255]
+    static void convolve_column_fixed(const int16_t* const* rows, const int16_t* weights, int taps,
+                                      uint8_t* out, int n);
+
+    // bits[i] = pixels[i] & 1 for n pixels
+    static void extract_lsb(const uint8_t* pixels, int* bits, int n);
+
+    // Replaces bit 0 of each of the n pixels with bits[i] & 1
+    static void embed_lsb(uint8_t* pixels, const int* bits, int n);
+
+    // Level the kernels currently run on
+    static CpuFeatures::Level get_level();
+
+    // Rebinds every kernel to the given level, lowered to what the CPU supports.
+    // Must not be called while another thread is running kernels.
+    static void set_level(CpuFeatures::Level level);
+
+    // Name of the instruction set the kernels run on ("scalar", "sse2", "avx2" or "avx512")
+    static const char* get_isa_name();
+};
+
+#endif // PIXEL_KERNELS_H
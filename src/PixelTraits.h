@@ -0,0 +1,56 @@
+#ifndef PIXEL_TRAITS_H
+#define PIXEL_TRAITS_H
+
+#include <cstdint>
+
+// What images, views and filters need to know about a pixel type. Three pixel types are
+// supported: uint8_t (0-255), uint16_t (0-65535) and float.
+//
+// Integer pixels saturate at the ends of their range, and filter results are rounded down
+// into it. Float pixels are never clamped or rounded, so intermediate results keep their
+// precision; they use the 8-bit scale, i.e. a pixel loaded from an 8-bit file keeps its value.
+template <typename Pixel>
+struct PixelTraits;
+
+// Shared by the integer pixel types; Sum holds the exact sum of many pixels
+template <typename Pixel, int Max, typename Sum>
+struct IntegerPixelTraits {
+    typedef int value_type;     // What get_pixel returns and set_pixel takes
+    typedef Sum sum_type;
+    static const bool is_integer = true;
+    static const int max_value = Max;
+
+    // Clamps an exact value into [0, Max]
+    static Pixel clamp(sum_type value) {
+        return static_cast<Pixel>(value < 0 ? 0 : (value > Max ? Max : value));
+    }
+
+    // Filter result: rounded down and clamped into [0, Max]
+    static Pixel from_double(double value) {
+        return value <= 0.0 ? 0 : (value >= Max ? static_cast<Pixel>(Max) : static_cast<Pixel>(value));
+    }
+
+    // Arithmetic result: rounded half up and clamped into [0, Max]
+    static Pixel from_double_rounded(double value) {
+        return from_double(value + 0.5);
+    }
+};
+
+template <>
+struct PixelTraits<uint8_t> : IntegerPixelTraits<uint8_t, 255, int> {};
+
+template <>
+struct PixelTraits<uint16_t> : IntegerPixelTraits<uint16_t, 65535, int64_t> {};
+
+template <>
+struct PixelTraits<float> {
+    typedef float value_type;
+    typedef double sum_type;
+    static const bool is_integer = false;
+
+    static float clamp(double value) { return static_cast<float>(value); }
+    static float from_double(double value) { return static_cast<float>(value); }
+    static float from_double_rounded(double value) { return static_cast<float>(value); }
+};
+
+#endif // PIXEL_TRAITS_H
@@ -0,0 +1,103 @@
+#include "RecursiveGaussian.h"
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+
+// Poles of the third-order filter for sigma = 2: a complex pair and a real pole
+static const std::complex<double> BASE_POLE(1.41650, 1.00829);
+static const double BASE_REAL_POLE = 1.86543;
+
+// Variance of the forward-backward filter whose poles are the base poles to the power 1 / q.
+// A first-order factor 1 / (1 - p z^-1) adds p / (1 - p)^2 in each direction.
+static double variance_for_scale(double q) {
+    const std::complex<double> p = std::pow(BASE_POLE, -1.0 / q);
+    const double p_real = std::pow(BASE_REAL_POLE, -1.0 / q);
+    return 2.0 * (2.0 * (p / ((1.0 - p) * (1.0 - p))).real() + p_real / ((1.0 - p_real) * (1.0 - p_real)));
+}
+
+// Constructor: find the pole scale q with variance sigma^2 by bisection (the variance grows
+// with q), then expand (1 - p z^-1)(1 - conj(p) z^-1)(1 - p_real z^-1) into the coefficients
+RecursiveGaussian::RecursiveGaussian(double sigma) : sigma(sigma) {
+    if (!(sigma > 0.0) || std::isinf(sigma)) {
+        throw std::invalid_argument("Sigma must be a positive number.");
+    }
+    const double target = sigma * sigma;
+    double low = 0.0;
+    double high = 1.0;
+    while (variance_for_scale(high) < target) {
+        low = high;
+        high *= 2.0;
+    }
+    for (int i = 0; i < 100 && high - low > 1e-12 * high; ++i) {
+        const double middle = 0.5 * (low + high);
+        if (variance_for_scale(middle) < target) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    const double q = 0.5 * (low + high);
+
+    const std::complex<double> p = std::pow(BASE_POLE, -1.0 / q);
+    const double p_real = std::pow(BASE_REAL_POLE, -1.0 / q);
+    const double pair_sum = 2.0 * p.real();
+    const double pair_product = std::norm(p);
+    a1 = pair_sum + p_real;
+    a2 = -(pair_product + pair_sum * p_real);
+    a3 = pair_product * p_real;
+    gain = 1.0 - a1 - a2 - a3;
+}
+
+int RecursiveGaussian::get_padding() const {
+    return static_cast<int>(std::ceil(4.0 * sigma));
+}
+
+void RecursiveGaussian::filter(double* data, int n, int count) const {
+    if (n <= 0) {
+        return;
+    }
+    // Causal pass. Before the line the filter is in the steady state of its first value,
+    // which for a gain of 1 means every earlier output equals that value.
+    for (int c = 0; c < count; ++c) {
+        const double first = data[c];
+        double w1 = first, w2 = first, w3 = first;
+        for (int i = 0; i < n && i < 3; ++i) {
+            double& x = data[static_cast<size_t>(i) * count + c];
+            x = gain * x + a1 * w1 + a2 * w2 + a3 * w3;
+            w3 = w2;
+            w2 = w1;
+            w1 = x;
+        }
+    }
+    for (int i = 3; i < n; ++i) {
+        double* x = data + static_cast<size_t>(i) * count;
+        const double* w1 = x - count;
+        const double* w2 = w1 - count;
+        const double* w3 = w2 - count;
+        for (int c = 0; c < count; ++c) {
+            x[c] = gain * x[c] + a1 * w1[c] + a2 * w2[c] + a3 * w3[c];
+        }
+    }
+
+    // Anti-causal pass, starting from the steady state of the last causal output
+    for (int c = 0; c < count; ++c) {
+        const double last = data[static_cast<size_t>(n - 1) * count + c];
+        double y1 = last, y2 = last, y3 = last;
+        for (int i = n - 1; i >= 0 && i >= n - 3; --i) {
+            double& x = data[static_cast<size_t>(i) * count + c];
+            x = gain * x + a1 * y1 + a2 * y2 + a3 * y3;
+            y3 = y2;
+            y2 = y1;
+            y1 = x;
+        }
+    }
+    for (int i = n - 4; i >= 0; --i) {
+        double* x = data + static_cast<size_t>(i) * count;
+        const double* y1 = x + count;
+        const double* y2 = y1 + count;
+        const double* y3 = y2 + count;
+        for (int c = 0; c < count; ++c) {
+            x[c] = gain * x[c] + a1 * y1[c] + a2 * y2[c] + a3 * y3[c];
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef RECURSIVE_GAUSSIAN_H
+#define RECURSIVE_GAUSSIAN_H
+
+// Recursive (IIR) approximation of a Gaussian of standard deviation sigma, after Young and
+// van Vliet: a third-order causal filter followed by the same filter run backwards, so the
+// cost per sample does not depend on sigma. The poles are the L2-optimal ones of van Vliet,
+// Young and Verbeek, scaled so that the impulse response has a variance of exactly sigma^2.
+// Unlike GaussianKernel the response is not truncated.
+class RecursiveGaussian {
+private:
+    double sigma;
+    double gain;            // 1 - a1 - a2 - a3, so a constant line passes unchanged
+    double a1, a2, a3;      // w[i] = gain * x[i] + a1 * w[i - 1] + a2 * w[i - 2] + a3 * w[i - 3]
+
+public:
+    // Constructor: solves for the pole scale of this sigma (sigma > 0)
+    explicit RecursiveGaussian(double sigma);
+
+    double get_sigma() const { return sigma; }
+
+    // How many samples a line should be extended by at each end before filtering, so that
+    // what lies beyond the extension no longer matters (4 sigma, rounded up)
+    int get_padding() const;
+
+    // Filters count interleaved lines of n samples each in place: sample i of line c is
+    // data[i * count + c]. Each line is assumed to continue with its end values beyond both
+    // ends, which is exact for a line padded with zeros or with copies of its end values.
+    void filter(double* data, int n, int count) const;
+};
+
+#endif // RECURSIVE_GAUSSIAN_H
@@ -1,5 +1,6 @@
 #include "SecretImage.h"
 #include <vector>
+#include <utility>
 
 // Constructor: split image into upper and lower triangular arrays
 SecretImage::SecretImage(const GrayscaleImage& image) {
@@ -62,6 +63,60 @@ SecretImage::SecretImage(int w, int h, int * upper, int * lower) {
 }
 
 
+// Copy constructor: allocate fresh arrays and copy both triangular parts
+SecretImage::SecretImage(const SecretImage& other)
+        : upper_triangular(new int[other.upper_tri_arr_size]),
+          lower_triangular(new int[other.lower_tri_arr_size]),
+          width(other.width), height(other.height),
+          upper_tri_arr_size(other.upper_tri_arr_size),
+          lower_tri_arr_size(other.lower_tri_arr_size) {
+    std::copy(other.upper_triangular, other.upper_triangular + upper_tri_arr_size, upper_triangular);
+    std::copy(other.lower_triangular, other.lower_triangular + lower_tri_arr_size, lower_triangular);
+}
+
+// Copy assignment
+SecretImage& SecretImage::operator=(const SecretImage& other) {
+    if (this != &other) {
+        SecretImage copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+// Move constructor: steal both arrays and leave other as an empty image
+SecretImage::SecretImage(SecretImage&& other) noexcept
+        : upper_triangular(other.upper_triangular),
+          lower_triangular(other.lower_triangular),
+          width(other.width), height(other.height),
+          upper_tri_arr_size(other.upper_tri_arr_size),
+          lower_tri_arr_size(other.lower_tri_arr_size) {
+    other.upper_triangular = nullptr;
+    other.lower_triangular = nullptr;
+    other.width = other.height = 0;
+    other.upper_tri_arr_size = other.lower_tri_arr_size = 0;
+}
+
+// Move assignment
+SecretImage& SecretImage::operator=(SecretImage&& other) noexcept {
+    if (this != &other) {
+        delete[] upper_triangular;
+        delete[] lower_triangular;
+
+        upper_triangular = other.upper_triangular;
+        lower_triangular = other.lower_triangular;
+        width = other.width;
+        height = other.height;
+        upper_tri_arr_size = other.upper_tri_arr_size;
+        lower_tri_arr_size = other.lower_tri_arr_size;
+
+        other.upper_triangular = nullptr;
+        other.lower_triangular = nullptr;
+        other.width = other.height = 0;
+        other.upper_tri_arr_size = other.lower_tri_arr_size = 0;
+    }
+    return *this;
+}
+
 // Destructor: free the arrays
 SecretImage::~SecretImage() {
     // Simply free the dynamically allocated memory
@@ -108,14 +163,15 @@ void SecretImage::save_back(const GrayscaleImage& image) {
     // based on the GrayscaleImage given as the parameter.
 
     for (int i = 0; i < height; ++i) {
+        const uint8_t* row = image.get_row(i);
         for (int j = 0; j < width; ++j) {
             if (j >= i){ // upper tri matrix
                 upper_triangular[(upper_tri_arr_size
                 - (((height - i) * (height - i - 1)) / 2)
                 - (height - j - 1)- 1)
-                ] = image.get_data()[i][j];
+                ] = row[j];
             } else {
-                lower_triangular[(((i*(i-1))/2) + j)] = image.get_data()[i][j];
+                lower_triangular[(((i*(i-1))/2) + j)] = row[j];
             }
         }
     }
@@ -197,6 +253,9 @@ SecretImage SecretImage::load_from_file(const std::string& filename) {
                 secret_image.set_upper_tri_arr_size();
                 secret_image.set_lower_tri_arr_size();
 
+                // Replace the empty arrays allocated by the placeholder constructor.
+                delete[] secret_image.upper_triangular;
+                delete[] secret_image.lower_triangular;
                 secret_image.set_upper_triangular(new int[secret_image.get_upper_tri_arr_size()]);
                 secret_image.set_lower_triangular(new int[secret_image.get_lower_tri_arr_size()]);
                 break;
@@ -27,10 +27,23 @@ public:
     // Constructor: instantiate based on data read from file
     SecretImage(int w, int h, int *upper, int *lower);
 
+    // Copy constructor: deep-copies both triangular arrays
+    SecretImage(const SecretImage &other);
+
+    // Copy assignment
+    SecretImage &operator=(const SecretImage &other);
+
+    // Move constructor: takes over both arrays, leaving other empty
+    SecretImage(SecretImage &&other) noexcept;
+
+    // Move assignment
+    SecretImage &operator=(SecretImage &&other) noexcept;
+
     // Destructor
     ~SecretImage();
 
-    // Function to reconstruct the image from two arrays
+    // Function to reconstruct the image from two arrays.
+    // The image is built in place and moved (or elided) out, never deep-copied.
     GrayscaleImage reconstruct() const;
 
     // Save back to triangular arrays after filtering
@@ -39,7 +52,8 @@ public:
     // Saves a secret image into the given file
     void save_to_file(const std::string &filename);
 
-    // Reads a secret image from the given file
+    // Reads a secret image from the given file.
+    // The arrays are allocated once and moved (or elided) out, never deep-copied.
     static SecretImage load_from_file(const std::string &filename);
 
     // Getters and setters for private instance variables
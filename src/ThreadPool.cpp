@@ -0,0 +1,139 @@
+#include "ThreadPool.h"
+#include <cstdlib>
+#include <memory>
+
+// Set on pool threads (and on a caller while it runs tasks) so nested loops run serially
+static thread_local bool inside_pool = false;
+
+// Resolves a requested thread count; <= 0 means one thread per hardware thread
+static int resolve_thread_count(int threads) {
+    if (threads > 0) {
+        return threads;
+    }
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? static_cast<int>(hardware) : 1;
+}
+
+// Constructor: start the worker threads
+ThreadPool::ThreadPool(int threads)
+        : task(nullptr), task_count(0), next_index(0), remaining(0), generation(0), stopping(false) {
+    int count = resolve_thread_count(threads);
+    for (int i = 1; i < count; ++i) {
+        workers.push_back(std::thread(&ThreadPool::worker_loop, this));
+    }
+}
+
+// Destructor: wake every worker with the stop flag set and wait for them
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+}
+
+void ThreadPool::worker_loop() {
+    inside_pool = true;
+    unsigned long seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_ready.wait(lock, [&]() { return stopping || generation != seen_generation; });
+            if (stopping) {
+                return;
+            }
+            seen_generation = generation;
+        }
+        run_tasks();
+    }
+}
+
+void ThreadPool::run_tasks() {
+    while (true) {
+        int index;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (next_index >= task_count) {
+                return;
+            }
+            index = next_index++;
+        }
+
+        try {
+            (*task)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            work_done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallel_for(int count, const std::function<void(int)>& loop_task) {
+    if (count <= 0) {
+        return;
+    }
+    if (count == 1 || workers.empty() || inside_pool) {
+        for (int i = 0; i < count; ++i) {
+            loop_task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &loop_task;
+        task_count = count;
+        next_index = 0;
+        remaining = count;
+        error = nullptr;
+        ++generation;
+    }
+    work_ready.notify_all();
+
+    // The calling thread takes part in the loop too.
+    inside_pool = true;
+    run_tasks();
+    inside_pool = false;
+
+    std::exception_ptr failure;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [&]() { return remaining == 0; });
+        task = nullptr;
+        task_count = 0;
+        failure = error;
+        error = nullptr;
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+// The shared pool, created on first use
+static std::mutex shared_mutex;
+static std::unique_ptr<ThreadPool> shared_pool;
+
+ThreadPool& ThreadPool::shared() {
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    if (!shared_pool) {
+        const char* configured = std::getenv("CLEARVISION_THREADS");
+        shared_pool.reset(new ThreadPool(configured != nullptr ? std::atoi(configured) : 0));
+    }
+    return *shared_pool;
+}
+
+void ThreadPool::set_shared_thread_count(int threads) {
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    shared_pool.reset(new ThreadPool(threads));
+}
@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run the indices of a parallel loop.
+// One process-wide pool is shared by all filters so threads are started once,
+// not per call. The thread calling parallel_for works on the loop as well.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex run_mutex;               // Serialises parallel_for calls from different threads
+    std::mutex mutex;                   // Guards everything below
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    const std::function<void(int)>* task;
+    int task_count;
+    int next_index;
+    int remaining;
+    unsigned long generation;
+    bool stopping;
+    std::exception_ptr error;
+
+    // Main loop of every worker thread
+    void worker_loop();
+
+    // Runs loop indices until none are left
+    void run_tasks();
+
+public:
+    // Constructor: starts threads - 1 workers (the caller of parallel_for is the last thread).
+    // threads <= 0 means one thread per hardware thread.
+    explicit ThreadPool(int threads);
+
+    // Destructor: stops and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total number of threads working on a parallel_for, including the caller
+    int get_thread_count() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Runs task(i) for every i in [0, count) and returns once all of them finished.
+    // Calls made from inside a task run serially on the calling thread. If a task throws,
+    // the first exception is rethrown here after the remaining tasks finished.
+    void parallel_for(int count, const std::function<void(int)>& task);
+
+    // The process-wide pool. Its size comes from the CLEARVISION_THREADS environment
+    // variable if set, otherwise one thread per hardware thread.
+    static ThreadPool& shared();
+
+    // Replaces the shared pool with one of the given size (<= 0: one per hardware thread).
+    // Must not be called while another thread is running filters.
+    static void set_shared_thread_count(int threads);
+};
+
+#endif // THREAD_POOL_H
@@ -2,6 +2,7 @@
 #include "SecretImage.h"
 #include "Filter.h"
 #include "Crypto.h"
+#include "ImageDifference.h"
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -13,26 +14,44 @@ std::string remove_extension(const std::string& filename) {
     return (last_dot != std::string::npos && last_dot > 0) ? filename.substr(0, last_dot) : filename;
 }
 
-// Applies a mean filter to the input image and saves the result
-void apply_mean_filter(const char* input_image, int kernel_size) {
-    GrayscaleImage img(input_image);
-    Filter::apply_mean_filter(img, kernel_size);
+// Parses an optional border mode argument (zero, replicate, reflect or wrap)
+Filter::BorderMode parse_border(const std::string& name) {
+    if (name == "zero") return Filter::BORDER_ZERO;
+    if (name == "replicate") return Filter::BORDER_REPLICATE;
+    if (name == "reflect") return Filter::BORDER_REFLECT;
+    if (name == "wrap") return Filter::BORDER_WRAP;
+    throw std::invalid_argument("Unknown border mode: " + name + " (expected zero, replicate, reflect or wrap)");
+}
+
+// Applies a mean filter to the input image and saves the result.
+// Image is GrayscaleImage, or GrayscaleImage16 to keep 16-bit inputs at 16 bits.
+template <typename Image>
+void apply_mean_filter(const char* input_image, int kernel_size, Filter::BorderMode border) {
+    Image img(input_image);
+    Filter::apply_mean_filter(img, kernel_size, border);
     std::string output_filename = "mean_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + ".png";
     img.save_to_file(output_filename.c_str());
 }
 
 // Applies Gaussian smoothing to the input image and saves the result
-void apply_gaussian_smoothing(const char* input_image, int kernel_size, double sigma) {
-    GrayscaleImage img(input_image);
-    Filter::apply_gaussian_smoothing(img, kernel_size, sigma);
+template <typename Image>
+void apply_gaussian_smoothing(const char* input_image, int kernel_size, double sigma, Filter::BorderMode border) {
+    Image img(input_image);
+    if (Filter::choose_gaussian_mode(kernel_size, sigma) == Filter::GAUSSIAN_RECURSIVE) {
+        std::cout << "Large sigma: using the recursive Gaussian approximation (at most "
+                  << Filter::get_recursive_gaussian_error(kernel_size, sigma)
+                  << " gray levels from the exact kernel)" << std::endl;
+    }
+    Filter::apply_gaussian_smoothing(img, kernel_size, sigma, Filter::GAUSSIAN_AUTO, border);
     std::string output_filename = "gaussian_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + "_" + std::to_string(sigma) + ".png";
     img.save_to_file(output_filename.c_str());
 }
 
 // Applies an unsharp mask to the input image to enhance sharpness and saves the result
-void apply_unsharp_mask(const char* input_image, int kernel_size, double amount) {
-    GrayscaleImage img(input_image);
-    Filter::apply_unsharp_mask(img, kernel_size, amount);
+template <typename Image>
+void apply_unsharp_mask(const char* input_image, int kernel_size, double amount, Filter::BorderMode border) {
+    Image img(input_image);
+    Filter::apply_unsharp_mask(img, kernel_size, amount, border);
     std::string output_filename = "unsharp_filtered_" + remove_extension(input_image) + "_" + std::to_string(kernel_size) + "_" + std::to_string(amount) + ".png";
     img.save_to_file(output_filename.c_str());
 }
@@ -53,13 +72,41 @@ void subtract_images(const char* img1, const char* img2) {
     result.save_to_file(output_filename.c_str());
 }
 
-// Compares two images and prints whether they are identical
+// Compares two images and prints whether they are identical.
+// Image is GrayscaleImage, or GrayscaleImage16 when either file is 16-bit, so that 16-bit
+// results are compared at full precision (an 8-bit file is widened to match).
+template <typename Image>
 void compare_images(const char* img1, const char* img2) {
-    GrayscaleImage image1(img1), image2(img2);
+    Image image1(img1), image2(img2);
     bool are_equal = (image1 == image2);
     std::cout << (are_equal ? "Images are equal." : "Images are not equal.") << std::endl;
 }
 
+// Compares two images allowing each pixel to differ by up to tolerance and prints the
+// difference statistics. Returns true if the images are equal within the tolerance, which is
+// in gray levels of Image.
+template <typename Image>
+bool compare_images(const char* img1, const char* img2, int tolerance) {
+    Image image1(img1), image2(img2);
+    if (image1.get_width() != image2.get_width() || image1.get_height() != image2.get_height()) {
+        std::cout << "Images are not equal (sizes " << image1.get_width() << "x" << image1.get_height() << " and "
+                  << image2.get_width() << "x" << image2.get_height() << ")." << std::endl;
+        return false;
+    }
+    ImageDifference difference = ImageDifference::compare(image1, image2);
+    bool within = difference.is_within(tolerance);
+    std::cout << (within ? "Images are equal" : "Images are not equal") << " within tolerance " << tolerance << "."
+              << std::endl;
+    std::cout << "MSE: " << difference.get_mse() << ", PSNR: " << difference.get_psnr() << " dB"
+              << ", max difference: " << difference.get_max_difference()
+              << ", differing pixels: " << difference.get_differing_pixels() << std::endl;
+    if (!difference.is_identical()) {
+        std::cout << "Differences within rows " << difference.get_top() << "-" << difference.get_bottom()
+                  << ", columns " << difference.get_left() << "-" << difference.get_right() << std::endl;
+    }
+    return within;
+}
+
 // Converts a GrayscaleImage to a SecretImage and saves it in a disguised format
 void disguise_image(const char* input_image) {
     GrayscaleImage img(input_image);
@@ -98,16 +145,17 @@ int main(int argc, char** argv) {
         throw std::invalid_argument(
             "Usage: clearvision <operation> <arg1> <arg2> .. \n"
             "Modes of operation: \n\n"
-            "clearvision mean <img> <kernel_size> \n"
-            "clearvision gauss <img> <kernel_size> <sigma> \n"
-            "clearvision unsharp <img> <kernel_size> <amount> \n"
+            "clearvision mean <img> <kernel_size> [border] \n"
+            "clearvision gauss <img> <kernel_size> <sigma> [border] \n"
+            "clearvision unsharp <img> <kernel_size> <amount> [border] \n"
             "clearvision add <img1> <img2> \n"
             "clearvision sub <img1> <img2> \n"
-            "clearvision equals <img1> <img2> \n"
+            "clearvision equals <img1> <img2> [--tolerance <max_diff>] \n"
             "clearvision disguise <img> <msg> \n"
             "clearvision reveal <img> <msg> \n"
             "clearvision enc <img> <msg> \n"
-            "clearvision dec <img> <msg_len>"
+            "clearvision dec <img> <msg_len> \n\n"
+            "border: zero (default), replicate, reflect or wrap"
         );
     }
 
@@ -116,16 +164,31 @@ int main(int argc, char** argv) {
     try {
         // Parse and execute the specified operation
         if (operation == "mean") {
-            if (argc < 4) throw std::invalid_argument("Usage: clearvision mean <img> <kernel_size>");
-            apply_mean_filter(argv[2], std::stoi(argv[3]));
+            if (argc < 4) throw std::invalid_argument("Usage: clearvision mean <img> <kernel_size> [border]");
+            Filter::BorderMode border = parse_border(argc > 4 ? argv[4] : "zero");
+            if (GrayscaleImage16::is_16_bit_file(argv[2])) {
+                apply_mean_filter<GrayscaleImage16>(argv[2], std::stoi(argv[3]), border);
+            } else {
+                apply_mean_filter<GrayscaleImage>(argv[2], std::stoi(argv[3]), border);
+            }
 
         } else if (operation == "gauss") {
-            if (argc < 5) throw std::invalid_argument("Usage: clearvision gauss <img> <kernel_size> <sigma>");
-            apply_gaussian_smoothing(argv[2], std::stoi(argv[3]), std::stof(argv[4]));
+            if (argc < 5) throw std::invalid_argument("Usage: clearvision gauss <img> <kernel_size> <sigma> [border]");
+            Filter::BorderMode border = parse_border(argc > 5 ? argv[5] : "zero");
+            if (GrayscaleImage16::is_16_bit_file(argv[2])) {
+                apply_gaussian_smoothing<GrayscaleImage16>(argv[2], std::stoi(argv[3]), std::stof(argv[4]), border);
+            } else {
+                apply_gaussian_smoothing<GrayscaleImage>(argv[2], std::stoi(argv[3]), std::stof(argv[4]), border);
+            }
 
         } else if (operation == "unsharp") {
-            if (argc < 5) throw std::invalid_argument("Usage: clearvision unsharp <img> <kernel_size> <amount>");
-            apply_unsharp_mask(argv[2], std::stoi(argv[3]), std::stof(argv[4]));
+            if (argc < 5) throw std::invalid_argument("Usage: clearvision unsharp <img> <kernel_size> <amount> [border]");
+            Filter::BorderMode border = parse_border(argc > 5 ? argv[5] : "zero");
+            if (GrayscaleImage16::is_16_bit_file(argv[2])) {
+                apply_unsharp_mask<GrayscaleImage16>(argv[2], std::stoi(argv[3]), std::stof(argv[4]), border);
+            } else {
+                apply_unsharp_mask<GrayscaleImage>(argv[2], std::stoi(argv[3]), std::stof(argv[4]), border);
+            }
 
         } else if (operation == "add") {
             if (argc < 4) throw std::invalid_argument("Usage: clearvision add <img1> <img2>");
@@ -136,8 +199,23 @@ int main(int argc, char** argv) {
             subtract_images(argv[2], argv[3]);
 
         } else if (operation == "equals") {
-            if (argc < 4) throw std::invalid_argument("Usage: clearvision equals <img1> <img2>");
-            compare_images(argv[2], argv[3]);
+            if (argc < 4 || (argc > 4 && (argc != 6 || std::string(argv[4]) != "--tolerance")))
+                throw std::invalid_argument("Usage: clearvision equals <img1> <img2> [--tolerance <max_diff>]");
+            bool is_16_bit = GrayscaleImage16::is_16_bit_file(argv[2]) || GrayscaleImage16::is_16_bit_file(argv[3]);
+            if (argc == 4) {
+                if (is_16_bit) {
+                    compare_images<GrayscaleImage16>(argv[2], argv[3]);
+                } else {
+                    compare_images<GrayscaleImage>(argv[2], argv[3]);
+                }
+            } else {
+                int tolerance = std::stoi(argv[5]);
+                if (tolerance < 0) throw std::invalid_argument("Tolerance must not be negative.");
+                bool within = is_16_bit ? compare_images<GrayscaleImage16>(argv[2], argv[3], tolerance)
+                                        : compare_images<GrayscaleImage>(argv[2], argv[3], tolerance);
+                // Exit status 2 lets scripts tell images outside the tolerance from errors (1)
+                if (!within) return 2;
+            }
 
         } else if (operation == "disguise") {
             if (argc < 3) throw std::invalid_argument("Usage: clearvision disguise <img>");